@@ -0,0 +1,260 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "client.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <grpc/grpc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace grpc;
+using namespace std;
+using namespace std::chrono;
+using namespace tensorflow;
+using namespace tensorflow::serving;
+using namespace videocapture::v1;
+
+namespace acap_runtime {
+
+TensorView::TensorView(const TensorProto& tensor) : _tensor(&tensor) {
+    for (auto& dim : tensor.tensor_shape().dim()) {
+        _dims.push_back(dim.size());
+    }
+}
+
+void MakeTensorProto(TensorProto& tensor,
+                     const DataType dtype,
+                     const vector<int64_t>& dims,
+                     const void* data,
+                     const size_t size) {
+    tensor.set_dtype(dtype);
+    tensor.clear_tensor_shape();
+    for (int64_t dim : dims) {
+        tensor.mutable_tensor_shape()->add_dim()->set_size(dim);
+    }
+    tensor.set_tensor_content(data, size);
+}
+
+SharedInput::SharedInput(const size_t size) : _size(size) {
+    static atomic<unsigned int> count{0};
+    _name = "/acap-runtime-input-" + to_string(getpid()) + "-" + to_string(count++);
+    _fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (0 > _fd) {
+        throw runtime_error("Could not create shared memory file " + _name);
+    }
+    if (0 != ftruncate(_fd, size)) {
+        close(_fd);
+        shm_unlink(_name.c_str());
+        throw runtime_error("Could not size shared memory file " + _name);
+    }
+    _data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (MAP_FAILED == _data) {
+        close(_fd);
+        shm_unlink(_name.c_str());
+        throw runtime_error("Could not map shared memory file " + _name);
+    }
+}
+
+SharedInput::~SharedInput() {
+    munmap(_data, _size);
+    close(_fd);
+    shm_unlink(_name.c_str());
+}
+
+void SharedInput::SetTensor(TensorProto& tensor, const vector<int64_t>& dims) const {
+    tensor.set_dtype(DT_STRING);
+    tensor.clear_tensor_shape();
+    for (int64_t dim : dims) {
+        tensor.mutable_tensor_shape()->add_dim()->set_size(dim);
+    }
+    tensor.clear_string_val();
+    tensor.add_string_val(_name);
+}
+
+void LatencyRecorder::Record(const steady_clock::duration latency, const bool ok) {
+    const double ms = duration<double, milli>(latency).count();
+    scoped_lock lock(_mutex);
+    if (MAX_SAMPLES > _samples.size()) {
+        _samples.push_back(ms);
+    } else {
+        _samples[_calls % MAX_SAMPLES] = ms;
+    }
+    _calls++;
+    _failures += ok ? 0 : 1;
+    _sumMs += ms;
+    _maxMs = max(_maxMs, ms);
+}
+
+LatencyStats LatencyRecorder::Stats() const {
+    LatencyStats stats;
+    vector<double> samples;
+    {
+        scoped_lock lock(_mutex);
+        stats.calls = _calls;
+        stats.failures = _failures;
+        stats.meanMs = 0 < _calls ? _sumMs / _calls : 0;
+        stats.maxMs = _maxMs;
+        samples = _samples;
+    }
+    if (!samples.empty()) {
+        auto percentile = [&samples](double p) {
+            auto nth = samples.begin() + static_cast<size_t>(p * (samples.size() - 1));
+            nth_element(samples.begin(), nth, samples.end());
+            return *nth;
+        };
+        stats.p50Ms = percentile(0.5);
+        stats.p99Ms = percentile(0.99);
+    }
+    return stats;
+}
+
+Client::Client(const ClientSettings& settings) : _settings(settings) {
+    shared_ptr<ChannelCredentials> credentials =
+        settings.credentials ? settings.credentials : InsecureChannelCredentials();
+
+    // Channels have their own connection, instead of sharing one through the
+    // global subchannel pool. Frames are larger than the default message limit.
+    ChannelArguments args;
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    args.SetMaxReceiveMessageSize(-1);
+    for (unsigned int i = 0; i < max(1u, settings.channels); i++) {
+        Channel channel;
+        channel.channel = CreateCustomChannel(settings.target, credentials, args);
+        channel.prediction = PredictionService::NewStub(channel.channel);
+        channel.capture = VideoCapture::NewStub(channel.channel);
+        _channels.push_back(move(channel));
+    }
+    for (const char* method :
+         {"Predict", "GetModelMetadata", "NewStream", "DeleteStream", "GetFrame", "GetFrames"}) {
+        _stats[method];
+    }
+}
+
+bool Client::WaitForConnected(const unsigned int timeoutMs) {
+    const auto deadline = system_clock::now() + milliseconds(timeoutMs);
+    for (auto& channel : _channels) {
+        if (!channel.channel->WaitForConnected(deadline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Client::Channel& Client::NextChannel() {
+    return _channels[_next++ % _channels.size()];
+}
+
+void Client::SetupContext(ClientContext& context) const {
+    if (!_settings.clientId.empty()) {
+        context.AddMetadata("client-id", _settings.clientId);
+    }
+    if (!_settings.priority.empty()) {
+        context.AddMetadata("priority", _settings.priority);
+    }
+    if (0 < _settings.timeoutMs) {
+        context.set_deadline(system_clock::now() + milliseconds(_settings.timeoutMs));
+    }
+}
+
+Status Client::Record(const string& method,
+                      const steady_clock::time_point start,
+                      const Status& status) {
+    _stats.at(method).Record(steady_clock::now() - start, status.ok());
+    return status;
+}
+
+Status Client::Predict(const PredictRequest& request, PredictResponse* response) {
+    ClientContext context;
+    SetupContext(context);
+    const auto start = steady_clock::now();
+    return Record("Predict", start, NextChannel().prediction->Predict(&context, request, response));
+}
+
+void Client::PredictAsync(const PredictRequest* request,
+                          PredictResponse* response,
+                          function<void(Status)> done) {
+    // The context must be kept until the call is done
+    ClientContext* context = new ClientContext;
+    SetupContext(*context);
+    const auto start = steady_clock::now();
+    NextChannel().prediction->async()->Predict(
+        context, request, response, [this, context, start, done](Status status) {
+            delete context;
+            done(Record("Predict", start, status));
+        });
+}
+
+Status Client::GetModelMetadata(const GetModelMetadataRequest& request,
+                                GetModelMetadataResponse* response) {
+    ClientContext context;
+    SetupContext(context);
+    const auto start = steady_clock::now();
+    return Record("GetModelMetadata",
+                  start,
+                  NextChannel().prediction->GetModelMetadata(&context, request, response));
+}
+
+Status Client::NewStream(const NewStreamRequest& request, NewStreamResponse* response) {
+    ClientContext context;
+    SetupContext(context);
+    const auto start = steady_clock::now();
+    return Record(
+        "NewStream", start, NextChannel().capture->NewStream(&context, request, response));
+}
+
+Status Client::DeleteStream(const DeleteStreamRequest& request, DeleteStreamResponse* response) {
+    ClientContext context;
+    SetupContext(context);
+    const auto start = steady_clock::now();
+    return Record(
+        "DeleteStream", start, NextChannel().capture->DeleteStream(&context, request, response));
+}
+
+Status Client::GetFrame(const GetFrameRequest& request, GetFrameResponse* response) {
+    ClientContext context;
+    SetupContext(context);
+    const auto start = steady_clock::now();
+    return Record("GetFrame", start, NextChannel().capture->GetFrame(&context, request, response));
+}
+
+Status Client::GetFrames(const GetFramesRequest& request,
+                         function<bool(const GetFrameResponse&)> onFrame) {
+    ClientContext context;
+    SetupContext(context);
+    const auto start = steady_clock::now();
+    auto reader = NextChannel().capture->GetFrames(&context, request);
+    GetFrameResponse frame;
+    bool cancelled = false;
+    while (reader->Read(&frame)) {
+        if (!onFrame(frame)) {
+            cancelled = true;
+            context.TryCancel();
+            break;
+        }
+    }
+    Status status = reader->Finish();
+    // Cancelled by the client, not a failure
+    return Record("GetFrames", start, cancelled ? Status::OK : status);
+}
+
+LatencyStats Client::Stats(const string& method) const {
+    auto stats = _stats.find(method);
+    return _stats.end() == stats ? LatencyStats() : stats->second.Stats();
+}
+}  // namespace acap_runtime
@@ -0,0 +1,206 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ACAP_RUNTIME_CLIENT_H
+#define ACAP_RUNTIME_CLIENT_H
+
+#include "prediction_service.grpc.pb.h"
+#include "videocapture.grpc.pb.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <grpcpp/grpcpp.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace acap_runtime {
+
+/**
+ * @brief View of the data of a tensor in a response, without a copy
+ *
+ * Only valid as long as the tensor it views. The data is that of the
+ * tensor_content field, in which the service returns all outputs.
+ */
+class TensorView {
+  public:
+    explicit TensorView(const tensorflow::TensorProto& tensor);
+
+    tensorflow::DataType DataType() const { return _tensor->dtype(); }
+    const std::vector<int64_t>& Dims() const { return _dims; }
+    // Size of the data in bytes
+    size_t Size() const { return _tensor->tensor_content().size(); }
+
+    template <typename T>
+    const T* Data() const {
+        return reinterpret_cast<const T*>(_tensor->tensor_content().data());
+    }
+    template <typename T>
+    size_t Count() const {
+        return Size() / sizeof(T);
+    }
+
+  private:
+    const tensorflow::TensorProto* _tensor;
+    std::vector<int64_t> _dims;
+};
+
+// Fill in a tensor of a request, the data is copied once into the tensor
+void MakeTensorProto(tensorflow::TensorProto& tensor,
+                     const tensorflow::DataType dtype,
+                     const std::vector<int64_t>& dims,
+                     const void* data,
+                     const size_t size);
+
+/**
+ * @brief Input in a shared memory file, which the service reads in place
+ *
+ * The file is created with a unique name and removed when the input is
+ * destroyed. Write the input data to Data() and refer to the file from a
+ * request with SetTensor(), then reuse it for the following requests.
+ */
+class SharedInput {
+  public:
+    explicit SharedInput(const size_t size);
+    ~SharedInput();
+    SharedInput(const SharedInput&) = delete;
+    SharedInput& operator=(const SharedInput&) = delete;
+
+    void* Data() { return _data; }
+    size_t Size() const { return _size; }
+    const std::string& Name() const { return _name; }
+
+    // Refer to the file from a tensor of a request, with the dims of the data
+    void SetTensor(tensorflow::TensorProto& tensor, const std::vector<int64_t>& dims) const;
+
+  private:
+    std::string _name;
+    size_t _size;
+    int _fd = -1;
+    void* _data = nullptr;
+};
+
+// Latency of the calls of a method, as seen by the client
+struct LatencyStats {
+    uint64_t calls = 0;
+    uint64_t failures = 0;
+    double meanMs = 0;
+    double maxMs = 0;
+    // Percentiles of the latest calls
+    double p50Ms = 0;
+    double p99Ms = 0;
+};
+
+class LatencyRecorder {
+  public:
+    void Record(const std::chrono::steady_clock::duration latency, const bool ok);
+    LatencyStats Stats() const;
+
+  private:
+    static const size_t MAX_SAMPLES = 1024;
+
+    mutable std::mutex _mutex;
+    uint64_t _calls = 0;     // Guarded by _mutex
+    uint64_t _failures = 0;  // Guarded by _mutex
+    double _sumMs = 0;       // Guarded by _mutex
+    double _maxMs = 0;       // Guarded by _mutex
+    std::vector<double> _samples;  // Ring of the latest calls, guarded by _mutex
+};
+
+// Settings of a client
+struct ClientSettings {
+    std::string target = "unix:///tmp/acap-runtime.sock";
+    // Credentials of the channels, insecure if not set
+    std::shared_ptr<grpc::ChannelCredentials> credentials;
+    // Number of channels, each with its own connection, that calls are spread over
+    unsigned int channels = 1;
+    // Client id and priority used by the scheduler of the service, if set
+    std::string clientId;
+    std::string priority;
+    // Deadline in ms of a call, 0 for no deadline
+    unsigned int timeoutMs = 0;
+};
+
+/**
+ * @brief Client of the inference and video capture services
+ *
+ * Channels and stubs are created once and reused by all calls, which are
+ * spread round-robin over the channels. Calls are threadsafe. The latency of
+ * every call is recorded by method name, e.g. "Predict".
+ */
+class Client {
+  public:
+    using DeleteStreamRequest = videocapture::v1::DeleteStreamRequest;
+    using DeleteStreamResponse = videocapture::v1::DeleteStreamResponse;
+    using GetFrameRequest = videocapture::v1::GetFrameRequest;
+    using GetFrameResponse = videocapture::v1::GetFrameResponse;
+    using GetFramesRequest = videocapture::v1::GetFramesRequest;
+    using GetModelMetadataRequest = tensorflow::serving::GetModelMetadataRequest;
+    using GetModelMetadataResponse = tensorflow::serving::GetModelMetadataResponse;
+    using NewStreamRequest = videocapture::v1::NewStreamRequest;
+    using NewStreamResponse = videocapture::v1::NewStreamResponse;
+    using PredictRequest = tensorflow::serving::PredictRequest;
+    using PredictResponse = tensorflow::serving::PredictResponse;
+    using Status = grpc::Status;
+
+    explicit Client(const ClientSettings& settings = ClientSettings());
+
+    // Wait until all channels are connected
+    bool WaitForConnected(const unsigned int timeoutMs);
+
+    Status Predict(const PredictRequest& request, PredictResponse* response);
+    // The request and response must be kept until done is called, on a gRPC
+    // thread that must not block
+    void PredictAsync(const PredictRequest* request,
+                      PredictResponse* response,
+                      std::function<void(Status)> done);
+    Status GetModelMetadata(const GetModelMetadataRequest& request,
+                            GetModelMetadataResponse* response);
+
+    Status NewStream(const NewStreamRequest& request, NewStreamResponse* response);
+    Status DeleteStream(const DeleteStreamRequest& request, DeleteStreamResponse* response);
+    Status GetFrame(const GetFrameRequest& request, GetFrameResponse* response);
+    // Receive the frames of a stream until onFrame returns false, which
+    // cancels the call, or the service ends it
+    Status GetFrames(const GetFramesRequest& request,
+                     std::function<bool(const GetFrameResponse&)> onFrame);
+
+    LatencyStats Stats(const std::string& method) const;
+
+  private:
+    struct Channel {
+        std::shared_ptr<grpc::Channel> channel;
+        std::unique_ptr<tensorflow::serving::PredictionService::Stub> prediction;
+        std::unique_ptr<videocapture::v1::VideoCapture::Stub> capture;
+    };
+
+    Channel& NextChannel();
+    void SetupContext(grpc::ClientContext& context) const;
+    Status Record(const std::string& method,
+                  const std::chrono::steady_clock::time_point start,
+                  const Status& status);
+
+    ClientSettings _settings;
+    std::vector<Channel> _channels;
+    std::atomic<unsigned int> _next{0};
+    // One recorder per method, created up front so the map is never changed
+    std::map<std::string, LatencyRecorder> _stats;
+};
+}  // namespace acap_runtime
+
+#endif
@@ -18,17 +18,20 @@
 #include <glib-unix.h>
 #include <glib.h>
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/resource_quota.h>
 #include <sys/stat.h>
 #include <syslog.h>
 #include <unistd.h>
 
 #include <sstream>
+#include <thread>
 
-#include "inference.h"
+#include "local_transport.h"
+#include "metrics.h"
 #include "parameter.h"
 #include "read_text.h"
+#include "runtime.h"
 #include "util.h"
-#include "video_capture.h"
 
 #define LOG(level)                     \
     if (_verbose || #level == "ERROR") \
@@ -49,6 +52,9 @@ bool _verbose = false;
 // Loop run on the main process
 static GMainLoop* loop = NULL;
 
+// Inference service, which reloads its models on SIGHUP
+static Inference* inference_service = NULL;
+
 /**
  * @brief Signals handling
  *
@@ -63,14 +69,49 @@ static gboolean handle_signals(gpointer signal_num) {
     return G_SOURCE_REMOVE;
 }
 
+/**
+ * @brief Stop the server when its run time is over
+ */
+static gboolean handle_run_time(gpointer) {
+    g_main_loop_quit(loop);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Reload models on SIGHUP
+ */
+static gboolean handle_reload(gpointer) {
+    if (inference_service != NULL) {
+        inference_service->ReloadModels();
+    }
+    return G_SOURCE_CONTINUE;
+}
+
 /**
  * @brief Initialize signals
  */
 static void init_signals(void) {
     g_unix_signal_add(SIGINT, handle_signals, GINT_TO_POINTER(SIGINT));
     g_unix_signal_add(SIGTERM, handle_signals, GINT_TO_POINTER(SIGTERM));
+    g_unix_signal_add(SIGHUP, handle_reload, NULL);
 }
 
+// Thread model and resource limits of the gRPC server
+struct ServerSettings {
+    // Threads that run blocking calls, 0 to run them on the gRPC threads
+    unsigned int workerThreads = thread::hardware_concurrency();
+    // Max number of threads of gRPC, 0 for no limit
+    int maxThreads = 0;
+    // Max memory in MB used by gRPC for calls, 0 for no limit
+    size_t memoryQuota = 0;
+    // Unix socket of the shared memory transport, empty to disable it
+    string localSocket;
+    // Number of request and response slots of a local client
+    unsigned int localSlots = 4;
+    // Size in MB of a slot, which holds all tensors of a request or response
+    size_t localSlotSize = 8;
+};
+
 // Initialize acap-runtime and start gRPC service
 static void RunServer(const string& address,
                       const int port,
@@ -78,7 +119,10 @@ static void RunServer(const string& address,
                       const unsigned int time,
                       const string& certificateFile,
                       const string& keyFile,
-                      const vector<string>& models) {
+                      const vector<string>& models,
+                      const ServerSettings& serverSettings,
+                      const InferenceSettings& settings,
+                      const CaptureSettings& captureSettings) {
     // Setup gRPC service and credentials
     LOG(INFO) << "RunServer port=" << port << " chipId=" << chipId << endl;
     ServerBuilder builder;
@@ -107,16 +151,64 @@ static void RunServer(const string& address,
     }
     LOG(INFO) << "Server listening on " << server_address.str() << endl;
 
+    // Limit the threads and memory of gRPC
+    if (0 < serverSettings.maxThreads || 0 < serverSettings.memoryQuota) {
+        ResourceQuota quota("acap-runtime");
+        if (0 < serverSettings.maxThreads) {
+            quota.SetMaxThreads(serverSettings.maxThreads);
+        }
+        if (0 < serverSettings.memoryQuota) {
+            quota.Resize(serverSettings.memoryQuota * 1024 * 1024);
+        }
+        builder.SetResourceQuota(quota);
+    }
+
+    // The server registers the services of an embedded runtime. They use the
+    // callback API and run blocking calls on its worker pool.
+    RuntimeSettings runtimeSettings;
+    runtimeSettings.verbose = _verbose;
+    runtimeSettings.chipId = chipId;
+    runtimeSettings.models = models;
+    runtimeSettings.inference = settings;
+    runtimeSettings.capture = captureSettings;
+    runtimeSettings.workerThreads = serverSettings.workerThreads;
+    Runtime runtime{runtimeSettings};
+    WorkerPool* workers = runtime.Workers();
+    LOG(INFO) << "Worker threads: " << serverSettings.workerThreads << endl;
+
+    // Register metrics service
+    Metrics metrics{_verbose};
+    builder.RegisterService(&metrics);
+
     // Register parameter service
-    Parameter parameter{_verbose};
+    Parameter parameter{_verbose, workers};
     builder.RegisterService(&parameter);
 
-    // Register video capture service
-    Capture capture{_verbose};
-    builder.RegisterService(&capture);
+    // Register video capture and inference services
+    builder.RegisterService(&runtime.CaptureService());
+    builder.RegisterService(&runtime.InferenceService());
 
-    Inference inference{_verbose, chipId, models, &capture};
-    builder.RegisterService(&inference);
+    // Serve co-located clients through shared memory, stopped before inference
+    unique_ptr<LocalTransport> localTransport;
+    if (!serverSettings.localSocket.empty()) {
+        localTransport = make_unique<LocalTransport>(
+            _verbose,
+            serverSettings.localSocket,
+            serverSettings.localSlots,
+            serverSettings.localSlotSize * 1024 * 1024,
+            [&runtime](const Runtime::PredictRequest* request,
+                       Runtime::PredictResponse* response,
+                       LocalTransport::DoneFunc done) {
+                runtime.Predict(*request, *response, move(done));
+            },
+            [&runtime](const LocalTransport::GetFrameRequest* request,
+                       LocalTransport::GetFrameResponse* response,
+                       int* fd) {
+                return runtime.CaptureService().ExportFrame(request, response, fd);
+            },
+            workers);
+        LOG(INFO) << "Local transport on " << serverSettings.localSocket << endl;
+    }
 
     // Start server
     unique_ptr<Server> server(builder.BuildAndStart());
@@ -133,36 +225,66 @@ static void RunServer(const string& address,
             throw runtime_error("Error setting uds permissions: "s + strerror(errno));
     }
 
-    // Wait for gRPC service termination
+    // Wait for gRPC service termination. The GLib event loop runs in all
+    // modes, since it dispatches the signals, including reloads on SIGHUP.
+    inference_service = &runtime.InferenceService();
+    loop = g_main_loop_new(NULL, FALSE);
     if (time > 0) {
         LOG(INFO) << "Server run time (s): " << time << endl;
-        sleep(time);
-    } else {
-        /* Run the GLib event loop. */
-        loop = g_main_loop_new(NULL, FALSE);
-        g_main_loop_run(loop);
-        g_main_loop_unref(loop);
+        g_timeout_add_seconds(time, handle_run_time, NULL);
     }
+    g_main_loop_run(loop);
+    g_main_loop_unref(loop);
 
     LOG(INFO) << "Server shutdown" << endl;
+    inference_service = NULL;
     server->Shutdown();
 }
 
 // Print help
 void Usage(const char* name) {
     cerr << "Usage: " << name
-         << " [-v] [-o] [-a address ] [-p port] [-j chip-id]  [-t runtime] [-c certificate-file] "
-            "[-k key-file] [-m model-file] ... [-m model-file]"
+         << " [-v] [-o] [-a address ] [-p port] [-j chip-id] ... [-j chip-id] [-t runtime] "
+            "[-c certificate-file] [-k key-file] [-m model-file] ... [-m model-file] "
+            "[-s starvation-limit] "
+            "[-w name=weight] ... [-w name=weight] [-q [model=]limit] ... [-q [model=]limit] "
+            "[-r cache-entries[,cache-memory]] [-e cache-ttl] [-b benchmark-runs] "
+            "[-f placement-file] [-l] "
+            "[-n model=mean,std] ... [-z model=scale,zero-point] ... [-x worker-threads] "
+            "[-y max-threads] [-u memory-quota] [-d local-socket] [-g local-slot-size] "
+            "[-i saved-frame-memory]"
          << endl
          << "  -v    Verbose" << endl
          << "  -a    IP address of server" << endl
          << "  -p    IP port of server" << endl
          << "  -o    Read settings from device parameters" << endl
-         << "  -j    Chip id (see larodChip in larod.h)" << endl
+         << "  -j    Chip id (see larodChip in larod.h), repeat to load models on more chips"
+         << endl
          << "  -t    Runtime in seconds (used for test)" << endl
          << "  -c    Certificate file for TLS authentication, insecure channel if omitted" << endl
          << "  -k    Private key file for TLS authentication, insecure channel if omitted" << endl
-         << "  -m    Larod model file" << endl;
+         << "  -m    Larod model file" << endl
+         << "  -s    Time in ms after which a low priority request is served, 0 for strict priority"
+         << endl
+         << "  -w    Scheduling weight of a client id or model file" << endl
+         << "  -q    Max number of requests in flight, in total or for a model file" << endl
+         << "  -r    Max number of cached inference results, 0 to disable the cache, and their"
+         << endl
+         << "        max size in MB, 32 by default" << endl
+         << "  -e    Time in ms that an inference result is cached" << endl
+         << "  -b    Place each model on the fastest chip, timed over this many inferences"
+         << endl
+         << "  -f    File in which model placements are saved" << endl
+         << "  -l    Reload models when their files change" << endl
+         << "  -n    Normalize float inputs of a model file, (value - mean) / std" << endl
+         << "  -z    Quantize float inputs of a model file, value / scale + zero-point" << endl
+         << "  -x    Threads that run blocking calls, 0 to run them on the gRPC threads" << endl
+         << "  -y    Max number of gRPC threads, 0 for no limit" << endl
+         << "  -u    Max memory in MB used by gRPC for calls, 0 for no limit" << endl
+         << "  -d    Unix socket of the shared memory transport for local clients" << endl
+         << "  -g    Size in MB of a request or response of the shared memory transport"
+         << endl
+         << "  -i    Memory in MB of the frames saved for later calls, of all streams" << endl;
 }
 
 // Main program
@@ -184,7 +306,10 @@ int AcapRuntime(int argc, char* argv[]) {
     int opt;
     optind = 0;  // Reset opt index
     vector<string> models;
-    while (-1 != (opt = getopt(argc, argv, "a:hvoj:m:p:t:c:k:"))) {
+    ServerSettings serverSettings;
+    InferenceSettings settings;
+    CaptureSettings captureSettings;
+    while (-1 != (opt = getopt(argc, argv, "a:hvoj:m:p:t:c:k:s:w:q:r:e:b:f:ln:z:x:y:u:d:g:i:"))) {
         switch (opt) {
             case 'a':
                 address.assign(optarg);
@@ -193,7 +318,12 @@ int AcapRuntime(int argc, char* argv[]) {
                 Usage(argv[0]);
                 return EXIT_SUCCESS;
             case 'j':
-                chipId = atoi(optarg);
+                // Further chips get replicas of the models
+                if (0 == chipId) {
+                    chipId = atoi(optarg);
+                } else {
+                    settings.replicaChips.push_back(atoi(optarg));
+                }
                 break;
             case 'm':
                 models.push_back(optarg);
@@ -216,6 +346,89 @@ int AcapRuntime(int argc, char* argv[]) {
             case 'k':
                 key_file.assign(optarg);
                 break;
+            case 's':
+                settings.starvationLimit = atoi(optarg);
+                break;
+            case 'w': {
+                const char* weight = strrchr(optarg, '=');
+                if (nullptr == weight) {
+                    Usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                settings.weights[string(optarg, weight - optarg)] = atof(weight + 1);
+                break;
+            }
+            case 'q': {
+                const char* limit = strrchr(optarg, '=');
+                if (nullptr == limit) {
+                    settings.maxInFlight = atoi(optarg);
+                } else {
+                    settings.modelMaxInFlight[string(optarg, limit - optarg)] = atoi(limit + 1);
+                }
+                break;
+            }
+            case 'r': {
+                size_t memory;
+                settings.cacheEntries = atoi(optarg);
+                if (1 == sscanf(optarg, "%*u,%zu", &memory)) {
+                    settings.cacheMemory = memory * 1024 * 1024;
+                }
+                break;
+            }
+            case 'e':
+                settings.cacheTtl = atoi(optarg);
+                break;
+            case 'b':
+                settings.benchmarkRuns = atoi(optarg);
+                break;
+            case 'f':
+                settings.placementFile.assign(optarg);
+                break;
+            case 'l':
+                settings.watchModels = true;
+                break;
+            case 'n': {
+                const char* values = strrchr(optarg, '=');
+                InputTransform& transform =
+                    settings.inputTransforms[string(optarg, values ? values - optarg : 0)];
+                if (nullptr == values ||
+                    2 != sscanf(values + 1, "%f,%f", &transform.mean, &transform.std) ||
+                    0 == transform.std) {
+                    Usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'z': {
+                const char* values = strrchr(optarg, '=');
+                InputTransform& transform =
+                    settings.inputTransforms[string(optarg, values ? values - optarg : 0)];
+                if (nullptr == values ||
+                    2 != sscanf(values + 1, "%f,%d", &transform.scale, &transform.zeroPoint) ||
+                    0 == transform.scale) {
+                    Usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'x':
+                serverSettings.workerThreads = atoi(optarg);
+                break;
+            case 'y':
+                serverSettings.maxThreads = atoi(optarg);
+                break;
+            case 'u':
+                serverSettings.memoryQuota = atoi(optarg);
+                break;
+            case 'd':
+                serverSettings.localSocket = optarg;
+                break;
+            case 'g':
+                serverSettings.localSlotSize = atoi(optarg);
+                break;
+            case 'i':
+                captureSettings.savedFrameMemory = strtoull(optarg, nullptr, 10) * 1024 * 1024;
+                break;
             default:
                 Usage(argv[0]);
                 return EXIT_FAILURE;
@@ -247,7 +460,16 @@ int AcapRuntime(int argc, char* argv[]) {
     LOG(INFO) << "Start " << argv[0] << endl;
     int ret = [&]() {
         try {
-            RunServer(address, ipPort, chipId, time, pem_file, key_file, models);
+            RunServer(address,
+                      ipPort,
+                      chipId,
+                      time,
+                      pem_file,
+                      key_file,
+                      models,
+                      serverSettings,
+                      settings,
+                      captureSettings);
             return 0;
         } catch (const exception& err) {
             syslog(LOG_ERR, "%s", err.what());
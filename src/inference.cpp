@@ -15,12 +15,20 @@
  */
 
 #include "inference.h"
+#include "metrics.h"
+#include "segmentation.h"
+#include "tensor_conversion.h"
+#include "tiling.h"
 #include <chrono>
 #include <fcntl.h>
 #include <grpcpp/grpcpp.h>
 #include <iomanip>
+#include <poll.h>
 #include <sstream>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #define ERRORLOG std::cerr << "ERROR in Inference: "
@@ -54,34 +62,201 @@ const char* const LAYOUTS[] = {"LAROD_TENSOR_LAYOUT_INVALID",
                                "LAROD_TENSOR_LAYOUT_NCHW",
                                "LAROD_TENSOR_LAYOUT_420SP"};
 
+// Get a value of the request metadata, or an empty string if not set
+inline string GetClientMetadata(const ServerContextBase* context, const char* key) {
+    if (nullptr == context) {
+        return "";
+    }
+    auto& metadata = context->client_metadata();
+    auto it = metadata.find(key);
+    return metadata.end() == it ? "" : string(it->second.data(), it->second.length());
+}
+
+static Metric& reloadSucceededMetric = Metrics::Register("reload.succeeded");
+static Metric& reloadFailedMetric = Metrics::Register("reload.failed");
+static Metric& reloadLatencyMetric = Metrics::Register("reload.latency_ms");
+static Metric& droppedBeforePreprocessingMetric =
+    Metrics::Register("inference.dropped.before_preprocessing");
+static Metric& droppedBeforeInferenceMetric =
+    Metrics::Register("inference.dropped.before_inference");
+
+// Check if the client is no longer waiting for the result of a request
+inline bool IsAbandoned(const ServerContextBase* context) {
+    return nullptr != context &&
+           (context->IsCancelled() || system_clock::now() >= context->deadline());
+}
+
+// Split a file path into its directory and file name
+inline pair<string, string> SplitPath(const string& path) {
+    const size_t slash = path.rfind('/');
+    if (string::npos == slash) {
+        return {".", path};
+    }
+    return {0 == slash ? "/" : path.substr(0, slash), path.substr(slash + 1)};
+}
+
+// Height, width and channels of an image tensor in NHWC or NCHW layout
+struct ImageShape {
+    size_t height;
+    size_t width;
+    size_t channels;
+};
+
+inline ImageShape GetImageShape(const larodTensorDims& dims, const bool planar) {
+    if (planar) {
+        return {dims.dims[2], dims.dims[3], dims.dims[1]};
+    }
+    return {dims.dims[1], dims.dims[2], dims.dims[3]};
+}
+
+// Check if a request image is planar, by where its channels are compared to
+// the model input. A shape that fits both layouts is in the layout of the model.
+inline bool IsPlanarRequest(const larodTensorDims& dims,
+                            const larodTensorDims& modelDims,
+                            const bool modelPlanar) {
+    if (4 != dims.len || 4 != modelDims.len) {
+        return false;
+    }
+    const size_t channels = GetImageShape(modelDims, modelPlanar).channels;
+    const bool interleavedShape = channels == dims.dims[3];
+    const bool planarShape = channels == dims.dims[1];
+    return interleavedShape && planarShape ? modelPlanar : planarShape;
+}
+
+// Status to return for a request that was abandoned by its client
+inline Status AbandonedStatus(const ServerContextBase* context) {
+    if (nullptr != context && system_clock::now() >= context->deadline()) {
+        return Status(StatusCode::DEADLINE_EXCEEDED, "Deadline exceeded");
+    }
+    return Status::CANCELLED;
+}
+
 Inference::Inference(const bool verbose,
                      const uint64_t chipId,
                      const vector<string>& models,
-                     Capture* captureService)
-    : _verbose(verbose) {
-    if (chipId <= 0)
+                     Capture* captureService,
+                     const InferenceSettings& settings,
+                     WorkerPool* workers)
+    : _verbose(verbose), _benchmarkRuns(settings.benchmarkRuns),
+      _watchModels(settings.watchModels), _placement(settings.placementFile),
+      _inputTransforms(settings.inputTransforms),
+      _scheduler(verbose,
+                 settings.starvationLimit,
+                 settings.weights,
+                 settings.maxInFlight,
+                 settings.modelMaxInFlight),
+      _resultCache(settings.cacheEntries, settings.cacheTtl, settings.cacheMemory),
+      _workers(workers) {
+    SetMessageAllocatorFor_Predict(&_predictAllocator);
+    if (chipId <= 0 && 0 == settings.benchmarkRuns)
         return;
 
-    larodError* error = nullptr;
-
     _captureService = captureService;
 
     TRACELOG << "Init chipId=" << chipId << endl;
 
-    // Connect to larod service
-    if (!larodConnect(&_conn, &error)) {
+    // Connect to larod service once per chip, the first chip is the primary.
+    // Models are placed on all given chips, or benchmarked on all chips.
+    vector<larodChip> chipIds = ListChips();
+    if (0 == _benchmarkRuns) {
+        chipIds = {static_cast<larodChip>(chipId)};
+        for (auto id : settings.replicaChips) {
+            chipIds.push_back(static_cast<larodChip>(id));
+        }
+    }
+    for (auto id : chipIds) {
+        _replicas.emplace_back();
+        _replicas.back().index = _replicas.size() - 1;
+        _replicas.back().chip = id;
+        if (!ConnectReplica(_replicas.back())) {
+            throw runtime_error("Could not Init Inference Service");
+        }
+    }
+
+    // One request runs at a time on each larod connection, see PlaceModel
+    _scheduler.SetCapacity(_replicas.size());
+
+    // Reloads are requested through an event and file changes through inotify
+    _wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (0 > _wakeFd) {
+        PrintErrorWithErrno("Failed to create reload event");
+        throw runtime_error("Could not Init Inference Service");
+    }
+    if (_watchModels) {
+        _inotifyFd = inotify_init1(IN_CLOEXEC);
+        if (0 > _inotifyFd) {
+            PrintErrorWithErrno("Failed to watch model files");
+            throw runtime_error("Could not Init Inference Service");
+        }
+    }
+
+    // Load models if any
+    for (auto& model : models) {
+        if (!PlaceModel(model)) {
+            throw runtime_error("Could not Init Inference Service");
+        }
+    }
+    _reloadThread = thread(&Inference::ReloadLoop, this);
+}
+
+Inference::~Inference() {
+    // Stop reloading before the models are deleted
+    if (_reloadThread.joinable()) {
+        _stopReload = true;
+        const uint64_t wake = 1;
+        if (0 > write(_wakeFd, &wake, sizeof(wake))) {
+            PrintErrorWithErrno("Failed to stop reloading");
+        }
+        _reloadThread.join();
+    }
+    if (0 <= _inotifyFd) {
+        close(_inotifyFd);
+    }
+    if (0 <= _wakeFd) {
+        close(_wakeFd);
+    }
+
+    for (auto& replica : _replicas) {
+        // Delete models
+        TRACELOG << "Deleting models loaded on chip " << replica.chip << ":" << endl;
+        for (auto& [model_name, model] : replica.models) {
+            TRACELOG << "- " << model_name << endl;
+        }
+        replica.models.clear();
+
+        // Disconnect from larod service
+        if (nullptr != replica.conn) {
+            TRACELOG << "Disconnecting from larod" << endl;
+            larodError* error = nullptr;
+            if (!larodDisconnect(&replica.conn, &error)) {
+                PrintError("Failed to disconnect", error);
+                larodClearError(&error);
+            }
+        }
+    }
+}
+
+// List the chips that can run models, leaving out image processing and debug chips
+vector<larodChip> Inference::ListChips() {
+    vector<larodChip> chips;
+    larodConnection* conn = nullptr;
+    larodError* error = nullptr;
+    if (!larodConnect(&conn, &error)) {
         PrintError("Connecting to larod FAILED", error);
         larodClearError(&error);
         throw runtime_error("Could not Init Inference Service");
     }
 
-    // List available chip id:s
     larodChip* chipIds = nullptr;
     size_t numChipIds = 0;
-    if (larodListChips(_conn, &chipIds, &numChipIds, &error)) {
+    if (larodListChips(conn, &chipIds, &numChipIds, &error)) {
         TRACELOG << "Available chip ids:" << endl;
         for (size_t i = 0; i < numChipIds; ++i) {
             TRACELOG << chipIds[i] << ": " << larodGetChipName(chipIds[i]) << endl;
+            if (LAROD_CHIP_DEBUG != chipIds[i] && LAROD_CHIP_LIBYUV != chipIds[i] &&
+                LAROD_CHIP_OPENCL != chipIds[i] && LAROD_CHIP_CVFLOW_PROC != chipIds[i]) {
+                chips.push_back(chipIds[i]);
+            }
         }
         free(chipIds);
     } else {
@@ -89,121 +264,733 @@ Inference::Inference(const bool verbose,
         larodClearError(&error);
     }
 
+    if (!larodDisconnect(&conn, &error)) {
+        PrintError("Failed to disconnect", error);
+        larodClearError(&error);
+    }
+    return chips;
+}
+
+// Connect to larod for the chip of a replica
+bool Inference::ConnectReplica(Replica& replica) {
+    larodError* error = nullptr;
+
+    if (!larodConnect(&replica.conn, &error)) {
+        PrintError("Connecting to larod FAILED", error);
+        larodClearError(&error);
+        return false;
+    }
+
     // Show selected chip
-    _chipId = static_cast<larodChip>(chipId);
-    TRACELOG << "Selected chip for this session: " << larodGetChipName(_chipId) << endl;
+    TRACELOG << "Selected chip for this session: " << larodGetChipName(replica.chip) << endl;
+
+    // Looked up once, since they are updated with _replicaMutex held
+    const string prefix = "replica." + to_string(replica.chip);
+    replica.inFlightMetric = &Metrics::Register(prefix + ".in_flight");
+    replica.requestsMetric = &Metrics::Register(prefix + ".requests");
+    replica.busyMsMetric = &Metrics::Register(prefix + ".busy_ms");
+    replica.utilizationMetric = &Metrics::Register(prefix + ".utilization");
+    return true;
+}
 
-    // Load models if any
-    _models.clear();
-    for (auto model : models) {
-        if (!LoadModel(*_conn, model.c_str(), _chipId, LAROD_ACCESS_PRIVATE)) {
-            throw runtime_error("Could not Init Inference Service");
+// Load a model file on every replica, or when benchmarking, only on the
+// replica with the lowest latency. Does nothing if the model is loaded.
+// Models are loaded and benchmarked without _replicaMutex held, so that
+// requests for models already placed are served meanwhile.
+bool Inference::PlaceModel(const string& modelFile) {
+    if (IsPlaced(modelFile)) {
+        return true;
+    }
+
+    // Models are placed one at a time, so that no model is placed twice
+    scoped_lock placeLock(_placeMutex);
+    if (IsPlaced(modelFile)) {
+        return true;
+    }
+
+    vector<pair<Replica*, ModelHandle>> loaded;
+    if (!(0 == _benchmarkRuns ? LoadOnAllReplicas(modelFile, loaded)
+                              : LoadOnFastestReplica(modelFile, loaded))) {
+        return false;
+    }
+    set<unsigned int> placed;
+    {
+        scoped_lock lock(_replicaMutex);
+        for (auto& [replica, model] : loaded) {
+            replica->models[modelFile] = model;
+            placed.insert(replica->index);
         }
+        CacheModelMetadata(modelFile);
     }
+
+    // Requests for the model are only started when one of its replicas is idle
+    _scheduler.PlaceModel(modelFile, placed);
+    WatchModel(modelFile);
+    return true;
 }
 
-Inference::~Inference() {
-    if (nullptr != _conn) {
-        // Delete models
-        TRACELOG << "Deleting loaded models:" << endl;
-        larodError* error = nullptr;
-        for (auto& [model_name, model] : _models) {
-            TRACELOG << "- " << model_name << endl;
-            if (!larodDeleteModel(_conn, model, &error)) {
-                PrintError("Failed to delete model", error);
-                larodClearError(&error);
+// Check if a model file is loaded on any replica
+bool Inference::IsPlaced(const string& modelFile) {
+    scoped_lock lock(_replicaMutex);
+    for (auto& replica : _replicas) {
+        if (replica.models.end() != replica.models.find(modelFile)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Load a model file on every replica
+// NB! Must be called with _placeMutex held
+bool Inference::LoadOnAllReplicas(const string& modelFile,
+                                  vector<pair<Replica*, ModelHandle>>& loaded) {
+    for (auto& replica : _replicas) {
+        TRACELOG << "Loading model file " << modelFile << " on chip " << replica.chip << endl;
+        ModelHandle model;
+        scoped_lock lock(replica.mutex);
+        if (!LoadModel(replica, modelFile.c_str(), LAROD_ACCESS_PRIVATE, model)) {
+            return false;
+        }
+        loaded.emplace_back(&replica, model);
+    }
+    return true;
+}
+
+// Load a model file on the replica with the lowest latency for it
+// NB! Must be called with _placeMutex held
+bool Inference::LoadOnFastestReplica(const string& modelFile,
+                                     vector<pair<Replica*, ModelHandle>>& loaded) {
+    struct stat modelStat;
+    if (0 != stat(modelFile.c_str(), &modelStat)) {
+        PrintErrorWithErrno(("Failed to open model file: " + modelFile).c_str());
+        return false;
+    }
+
+    // Reuse an earlier decision if the model and the chip are still the same
+    PlacementRecord record;
+    if (_placement.Find(modelFile, modelStat.st_size, modelStat.st_mtime, record)) {
+        for (auto& replica : _replicas) {
+            if (record.chip == replica.chip) {
+                TRACELOG << "Loading model file " << modelFile << " on saved chip "
+                         << replica.chip << endl;
+                ModelHandle model;
+                scoped_lock lock(replica.mutex);
+                if (!LoadModel(replica, modelFile.c_str(), LAROD_ACCESS_PRIVATE, model)) {
+                    return false;
+                }
+                loaded.emplace_back(&replica, model);
+                return true;
             }
         }
+    }
 
-        // Disconnect from larod service
-        TRACELOG << "Disconnecting from larod" << endl;
-        if (!larodDisconnect(&_conn, &error)) {
-            PrintError("Failed to disconnect", error);
-            larodClearError(&error);
+    // Benchmark the model on every chip that can load it
+    record = PlacementRecord{static_cast<uint64_t>(modelStat.st_size), modelStat.st_mtime, 0, {}};
+    map<uint64_t, pair<Replica*, ModelHandle>> candidates;
+    for (auto& replica : _replicas) {
+        TRACELOG << "Benchmarking model file " << modelFile << " on chip " << replica.chip
+                 << endl;
+        ModelHandle model;
+        double latency;
+        scoped_lock lock(replica.mutex);
+        if (!LoadModel(replica, modelFile.c_str(), LAROD_ACCESS_PRIVATE, model)) {
+            continue;
+        }
+        if (BenchmarkModel(replica, model.get(), _benchmarkRuns, latency)) {
+            TRACELOG << "Latency on chip " << replica.chip << ": " << latency << " ms" << endl;
+            record.latencies[replica.chip] = latency;
+            candidates[replica.chip] = {&replica, model};
         }
     }
+    if (record.latencies.empty()) {
+        ERRORLOG << "No chip can run model " << modelFile << endl;
+        return false;
+    }
 
-    for (auto& [model_name, model] : _models) {
-        larodDestroyModel(&model);
+    // Keep the model only on the fastest chip, the others are deleted with their handles
+    record.chip = Placement::Fastest(record.latencies);
+    loaded.push_back(candidates[record.chip]);
+    TRACELOG << "Placed model file " << modelFile << " on chip " << record.chip << endl;
+    _placement.Store(modelFile, record);
+    return true;
+}
+
+// Measure the mean latency of a model, with inputs of zeros. With no timed
+// runs the model is only warmed up.
+bool Inference::BenchmarkModel(Replica& replica,
+                               larodModel* model,
+                               const unsigned int runs,
+                               double& latency) {
+    larodError* error = nullptr;
+    size_t numInputs = 0;
+    size_t numOutputs = 0;
+    larodJobRequest* jobReq = nullptr;
+    bool ret = false;
+
+    larodTensor** inputs = larodAllocModelInputs(
+        replica.conn, model, LAROD_FD_PROP_READWRITE, &numInputs, nullptr, &error);
+    larodTensor** outputs = larodAllocModelOutputs(
+        replica.conn, model, LAROD_FD_PROP_READWRITE, &numOutputs, nullptr, &error);
+    if (nullptr == inputs || nullptr == outputs) {
+        PrintError("Failed to allocate tensors for benchmark", error);
+        goto benchmark_end;
+    }
+    jobReq = larodCreateJobRequest(model, inputs, numInputs, outputs, numOutputs, nullptr, &error);
+    if (nullptr == jobReq) {
+        PrintError("Failed to create benchmark request", error);
+        goto benchmark_end;
+    }
+
+    // The first run is a warm-up and is not timed
+    latency = 0;
+    for (unsigned int i = 0; i <= runs; i++) {
+        const auto start = steady_clock::now();
+        if (!larodRunJob(replica.conn, jobReq, &error)) {
+            PrintError("Benchmark request failed", error);
+            goto benchmark_end;
+        }
+        if (0 < i) {
+            latency += duration<double, milli>(steady_clock::now() - start).count();
+        }
+    }
+    latency = 0 < runs ? latency / runs : 0;
+    ret = true;
+
+benchmark_end:
+    larodDestroyJobRequest(&jobReq);
+    larodDestroyTensors(&inputs, numInputs);
+    larodDestroyTensors(&outputs, numOutputs);
+    larodClearError(&error);
+    return ret;
+}
+
+// Watch the directory of a model file for new versions of the file. The
+// directory is watched since files are often replaced rather than rewritten.
+// NB! Must be called with _replicaMutex held
+void Inference::WatchModel(const string& modelFile) {
+    if (0 > _inotifyFd) {
+        return;
+    }
+    const string dir = SplitPath(modelFile).first;
+    const int watch = inotify_add_watch(_inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (0 > watch) {
+        PrintErrorWithErrno(("Failed to watch directory " + dir).c_str());
+        return;
+    }
+    TRACELOG << "Watching model file " << modelFile << endl;
+    _watchedDirs[watch] = dir;
+}
+
+// Queue the loaded models stored in a changed file for reload
+void Inference::FileChanged(const int watch, const char* name) {
+    scoped_lock lock(_replicaMutex);
+    auto dir = _watchedDirs.find(watch);
+    if (_watchedDirs.end() == dir) {
+        return;
+    }
+    for (auto& replica : _replicas) {
+        for (auto& [modelFile, model] : replica.models) {
+            if (make_pair(dir->second, string(name)) == SplitPath(modelFile)) {
+                TRACELOG << "Model file " << modelFile << " changed" << endl;
+                RequestReload(modelFile);
+            }
+        }
+    }
+}
+
+void Inference::ReloadModels() {
+    scoped_lock lock(_replicaMutex);
+    for (auto& replica : _replicas) {
+        for (auto& [modelFile, model] : replica.models) {
+            RequestReload(modelFile);
+        }
+    }
+}
+
+// Queue a model for reload by the reload thread
+void Inference::RequestReload(const string& modelFile) {
+    {
+        scoped_lock lock(_reloadMutex);
+        _reloadQueue.insert(modelFile);
+    }
+    const uint64_t wake = 1;
+    if (0 > write(_wakeFd, &wake, sizeof(wake))) {
+        PrintErrorWithErrno("Failed to request reload");
+    }
+}
+
+// Reload queued models and watch model files for changes. Models are
+// reloaded here so that slow loads never hold up the threads serving requests.
+void Inference::ReloadLoop() {
+    pollfd fds[] = {{_wakeFd, POLLIN, 0}, {_inotifyFd, POLLIN, 0}};
+    alignas(inotify_event) char events[4096];
+    while (!_stopReload) {
+        if (0 > poll(fds, 2, -1)) {
+            if (EINTR == errno) {
+                continue;
+            }
+            PrintErrorWithErrno("Failed to wait for reloads");
+            return;
+        }
+        if (0 != (fds[0].revents & POLLIN)) {
+            uint64_t count;
+            if (0 > read(_wakeFd, &count, sizeof(count))) {
+                PrintErrorWithErrno("Failed to read reload event");
+            }
+        }
+        if (0 != (fds[1].revents & POLLIN)) {
+            const ssize_t length = read(_inotifyFd, events, sizeof(events));
+            for (ssize_t i = 0; i < length;) {
+                const auto event = reinterpret_cast<const inotify_event*>(events + i);
+                if (0 < event->len) {
+                    FileChanged(event->wd, event->name);
+                }
+                i += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        set<string> modelFiles;
+        {
+            scoped_lock lock(_reloadMutex);
+            modelFiles.swap(_reloadQueue);
+        }
+        for (auto& modelFile : modelFiles) {
+            if (!_stopReload) {
+                ReloadModel(modelFile);
+            }
+        }
     }
 }
 
+// Load a new version of a model file on every replica that has the model,
+// warm it up and swap it in. Requests that already run on the old version
+// finish on it, and it is deleted when the last of them is done. If the new
+// version fails to load anywhere, the old version is kept everywhere.
+bool Inference::ReloadModel(const string& modelFile) {
+    const auto start = steady_clock::now();
+    vector<Replica*> replicas;
+    {
+        scoped_lock lock(_replicaMutex);
+        for (auto& replica : _replicas) {
+            if (replica.models.end() != replica.models.find(modelFile)) {
+                replicas.push_back(&replica);
+            }
+        }
+    }
+    if (replicas.empty()) {
+        ERRORLOG << "Model " << modelFile << " is not loaded and can not be reloaded" << endl;
+        reloadFailedMetric.Add();
+        return false;
+    }
+
+    // Load and warm up the new version, while the old one keeps serving. When
+    // models are benchmarked, the new version is timed for its placement record.
+    TRACELOG << "Reloading model file " << modelFile << endl;
+    scoped_lock placeLock(_placeMutex);
+    PlacementRecord record;
+    vector<ModelHandle> models;
+    for (auto replica : replicas) {
+        ModelHandle model;
+        double latency;
+        scoped_lock lock(replica->mutex);
+        if (!LoadModel(*replica, modelFile.c_str(), LAROD_ACCESS_PRIVATE, model) ||
+            !BenchmarkModel(*replica, model.get(), _benchmarkRuns, latency)) {
+            ERRORLOG << "Failed to reload model " << modelFile << ", keeping the old version"
+                     << endl;
+            reloadFailedMetric.Add();
+            return false;
+        }
+        record.chip = replica->chip;
+        record.latencies[replica->chip] = latency;
+        models.push_back(model);
+    }
+
+    // The saved placement is kept for the new version of the file
+    struct stat modelStat;
+    if (0 < _benchmarkRuns && 0 == stat(modelFile.c_str(), &modelStat)) {
+        record.size = modelStat.st_size;
+        record.mtime = modelStat.st_mtime;
+        _placement.Store(modelFile, record);
+    }
+
+    // Swap, unless the model was unloaded meanwhile
+    {
+        scoped_lock lock(_replicaMutex);
+        for (size_t i = 0; i < replicas.size(); i++) {
+            auto it = replicas[i]->models.find(modelFile);
+            if (replicas[i]->models.end() != it) {
+                it->second = models[i];
+            }
+        }
+        CacheModelMetadata(modelFile);
+    }
+    _resultCache.Clear();
+
+    const double ms = duration<double, milli>(steady_clock::now() - start).count();
+    TRACELOG << "Reloaded model file " << modelFile << " in " << ms << " ms" << endl;
+    reloadSucceededMetric.Add();
+    reloadLatencyMetric.Set(ms);
+    return true;
+}
+
+// Take the replica that the scheduler picked for a request, which is idle
+// and holds the model
+Inference::Replica& Inference::SelectReplica(const unsigned int index,
+                                             const string& modelName,
+                                             ModelHandle& model) {
+    scoped_lock lock(_replicaMutex);
+    Replica& selected = *next(_replicas.begin(), index);
+    selected.inFlight++;
+    selected.inFlightMetric->Set(selected.inFlight);
+    model = selected.models[modelName];
+    return selected;
+}
+
+// Update the load of a replica when a request is done
+void Inference::ReleaseReplica(Replica& replica, const steady_clock::duration executionTime) {
+    const double ms = duration<double, milli>(executionTime).count();
+
+    scoped_lock lock(_replicaMutex);
+    replica.inFlight--;
+    replica.busyTime += executionTime;
+
+    replica.inFlightMetric->Set(replica.inFlight);
+    replica.requestsMetric->Add();
+    replica.busyMsMetric->Add(ms);
+    replica.utilizationMetric->Set(duration<double>(replica.busyTime) /
+                                   (steady_clock::now() - replica.created));
+}
+
+// Serves a Predict call without holding a thread while it waits. The call waits
+// in the scheduler and is handed to the worker pool only once it has a replica,
+// so requests are served in the order of the scheduler and never wait in the
+// queue of the pool. Done is called once, with the status of the call. The call
+// is kept alive by its pending work, as it may be cancelled after it is done.
+class Inference::PredictCall : public enable_shared_from_this<PredictCall> {
+  public:
+    PredictCall(Inference& inference,
+                ServerContextBase* context,
+                const PredictRequest* request,
+                PredictResponse* response,
+                PredictDoneFunc done)
+        : _inference(inference), _context(context), _request(request), _response(response),
+          _done(move(done)) {}
+
+    // Check the request and schedule it. A model that is not loaded yet is
+    // placed on the worker pool first, since that blocks.
+    void Start() {
+        Status status;
+        if (!_inference.CheckRequest(_request, _response, status)) {
+            _done(status);
+            return;
+        }
+        if (_inference.IsPlaced(_request->model_spec().name())) {
+            Schedule();
+            return;
+        }
+        _inference._workers->Run([self = shared_from_this()] {
+            if (self->_inference.PlaceModel(self->_request->model_spec().name())) {
+                self->Schedule();
+            } else {
+                self->_done(Status::CANCELLED);
+            }
+        });
+    }
+
+    // Drop the request if it is queued in the scheduler
+    void Cancel() {
+        const uint64_t ticket = _ticket;
+        if (NO_TICKET != ticket) {
+            _inference._scheduler.Cancel(ticket);
+        }
+    }
+
+  private:
+    static const uint64_t NO_TICKET = UINT64_MAX;
+
+    void Schedule() {
+        _cacheKey = _inference.MakeCacheKey(_request);
+        if (_inference.LookupResult(_cacheKey, _response)) {
+            _done(Status::OK);
+            return;
+        }
+        Priority priority;
+        string client;
+        Scheduler::Clock::time_point deadline;
+        _inference.GetSchedule(_context, priority, client, deadline);
+
+        // The context is valid while the request is queued, as the call is
+        // not done before it leaves the queue
+        auto self = shared_from_this();
+        _ticket = _inference._scheduler.Enqueue(
+            priority,
+            client,
+            _request->model_spec().name(),
+            deadline,
+            [self] { return nullptr != self->_context && self->_context->IsCancelled(); },
+            [self](const Scheduler::Result result, const unsigned int replica) {
+                self->Scheduled(result, replica);
+            });
+    }
+
+    void Scheduled(const Scheduler::Result result, const unsigned int replica) {
+        if (Scheduler::Result::REJECTED == result) {
+            _done(_inference.RejectedStatus(_context));
+        } else if (Scheduler::Result::DROPPED == result) {
+            _done(AbandonedStatus(_context));
+        } else {
+            // Ahead of the queued work of the pool, since it holds a replica
+            _inference._workers->Run(
+                [self = shared_from_this(), replica] {
+                    Status status;
+                    {
+                        Scheduler::Slot slot(self->_inference._scheduler,
+                                             self->_request->model_spec().name(),
+                                             Scheduler::Result::ACQUIRED,
+                                             replica);
+                        status = self->_inference.RunPredict(self->_context,
+                                                             self->_request,
+                                                             self->_response,
+                                                             self->_cacheKey,
+                                                             replica);
+                    }
+                    self->_done(status);
+                },
+                true);
+        }
+    }
+
+    Inference& _inference;
+    ServerContextBase* _context;
+    const PredictRequest* _request;
+    PredictResponse* _response;
+    PredictDoneFunc _done;
+    CacheKey _cacheKey;
+    atomic<uint64_t> _ticket{NO_TICKET};
+};
+
+// Serves a Predict call of the callback API, which is finished when the call
+// is done
+class Inference::PredictReactor : public ServerUnaryReactor {
+  public:
+    PredictReactor(Inference& inference,
+                   CallbackServerContext* context,
+                   const PredictRequest* request,
+                   PredictResponse* response)
+        : _call(make_shared<PredictCall>(inference,
+                                         context,
+                                         request,
+                                         response,
+                                         [this](const Status& status) { Finish(status); })) {}
+
+    void Start() { _call->Start(); }
+
+    void OnCancel() override { _call->Cancel(); }
+
+    void OnDone() override { delete this; }
+
+  private:
+    shared_ptr<PredictCall> _call;
+};
+
+ServerUnaryReactor* Inference::Predict(CallbackServerContext* context,
+                                       const PredictRequest* request,
+                                       PredictResponse* response) {
+    if (nullptr == _workers) {
+        return Dispatch(_workers, context, [this, context, request, response] {
+            return Predict(static_cast<ServerContextBase*>(context), request, response);
+        });
+    }
+    auto reactor = new PredictReactor(*this, context, request, response);
+    reactor->Start();
+    return reactor;
+}
+
+void Inference::Predict(const PredictRequest* request,
+                        PredictResponse* response,
+                        PredictDoneFunc done) {
+    if (nullptr == _workers) {
+        done(Predict(static_cast<ServerContextBase*>(nullptr), request, response));
+        return;
+    }
+    make_shared<PredictCall>(*this, nullptr, request, response, move(done))->Start();
+}
+
+ServerUnaryReactor* Inference::GetModelMetadata(CallbackServerContext* context,
+                                                const GetModelMetadataRequest* request,
+                                                GetModelMetadataResponse* response) {
+    return Dispatch(_workers, context, [this, context, request, response] {
+        return GetModelMetadata(static_cast<ServerContextBase*>(context), request, response);
+    });
+}
+
 // Run inference on a single image
-Status Inference::Predict(ServerContext* context,
+Status Inference::Predict(ServerContextBase* context,
                           const PredictRequest* request,
                           PredictResponse* response) {
-    auto status = Status::CANCELLED;
-    bool ret;
-    larodError* error = nullptr;
-    larodJobRequest* ppJobReq;
-    larodJobRequest* jobReq;
-    uint64_t totalTime;
-    uint64_t larodTime;
-    vector<pair<FILE*, int>> inFiles;
-    vector<pair<FILE*, int>> outFiles;
-    uint32_t frame_ref;
-    (void)context;
+    Status status;
+    if (!CheckRequest(request, response, status)) {
+        return status;
+    }
 
-    // Validate parameters
-    if (nullptr == _conn) {
-        ERRORLOG << "No valid larod connection" << endl;
+    // Find model, or try to load it from file
+    const string& model_name = request->model_spec().name();
+    if (!PlaceModel(model_name)) {
         return Status::CANCELLED;
     }
+
+    // Serve repeated requests without running larod
+    const CacheKey cacheKey = MakeCacheKey(request);
+    if (LookupResult(cacheKey, response)) {
+        return Status::OK;
+    }
+
+    // Wait for the scheduler to pick this request, by priority and fairness
+    Priority priority;
+    string client;
+    Scheduler::Clock::time_point deadline;
+    GetSchedule(context, priority, client, deadline);
+    Scheduler::Slot slot(_scheduler, priority, client, model_name, deadline, [context] {
+        return nullptr != context && context->IsCancelled();
+    });
+    if (slot.Rejected()) {
+        return RejectedStatus(context);
+    }
+    if (!slot.Acquired()) {
+        return AbandonedStatus(context);
+    }
+    return RunPredict(context, request, response, cacheKey, slot.Replica());
+}
+
+// Validate the parameters of a predict request
+bool Inference::CheckRequest(const PredictRequest* request,
+                             const PredictResponse* response,
+                             Status& status) {
+    status = Status::CANCELLED;
+    if (_replicas.empty()) {
+        ERRORLOG << "No valid larod connection" << endl;
+        return false;
+    }
     if (nullptr == request) {
         ERRORLOG << "Unexpected NULL request in parameter" << endl;
-        return Status::CANCELLED;
+        return false;
     }
     if (nullptr == response) {
         ERRORLOG << "Unexpected NULL response in parameter" << endl;
-        return Status::CANCELLED;
+        return false;
     }
+    TRACELOG << "Incoming request:" << request->model_spec().DebugString();
+    return true;
+}
 
-    // Print request info and start timing
-    if (_verbose) {
-        totalTime = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-        TRACELOG << "Incoming request:" << request->model_spec().DebugString();
+// Key of a request in the result cache, which is only built when the cache is
+// enabled. The generation is taken before the request selects its model, so
+// that its result is not inserted if the model is reloaded meanwhile.
+Inference::CacheKey Inference::MakeCacheKey(const PredictRequest* request) {
+    if (!_resultCache.Enabled()) {
+        return CacheKey();
+    }
+    CacheKey cacheKey;
+    cacheKey.generation = _resultCache.Generation();
+    cacheKey.key =
+        ResultCacheKey(request, request->model_spec().name(), request->frame_reference());
+    return cacheKey;
+}
+
+// Serve a request from the result cache, returns false if it is not cached
+bool Inference::LookupResult(const CacheKey& cacheKey, PredictResponse* response) {
+    if (_resultCache.Lookup(cacheKey.key, *response)) {
+        TRACELOG << "Result served from cache" << endl;
+        return true;
     }
+    return false;
+}
 
-    // Find model
-    string modelName = request->model_spec().name();
-    auto model_it = _models.find(modelName);
-    if (_models.end() == model_it) {
-        // Try to load model from file
-        TRACELOG << "Loading model file " << modelName << endl;
-        if (!LoadModel(*_conn, modelName.c_str(), _chipId, LAROD_ACCESS_PRIVATE)) {
-            return Status::CANCELLED;
-        }
+// Get how a request is scheduled, from the metadata and deadline of its call
+void Inference::GetSchedule(const ServerContextBase* context,
+                            Priority& priority,
+                            string& client,
+                            Scheduler::Clock::time_point& deadline) {
+    priority = Scheduler::ParsePriority(GetClientMetadata(context, "priority"));
+    client = GetClientMetadata(context, "client-id");
+    if (client.empty() && nullptr != context) {
+        client = context->peer();
+    }
+    deadline = Scheduler::Clock::time_point::max();
+    if (nullptr != context && system_clock::time_point::max() != context->deadline()) {
+        deadline = Scheduler::Clock::now() + duration_cast<Scheduler::Clock::duration>(
+                                                 context->deadline() - system_clock::now());
+    }
+    TRACELOG << "Scheduling " << Scheduler::PriorityName(priority) << " priority request from "
+             << client << endl;
+}
 
-        model_it = _models.find(modelName);
-        if (_models.end() == model_it) {
-            ERRORLOG << "Unknown model " << modelName << endl;
-            return Status::CANCELLED;
-        }
+// Shed load, with a hint of when the current requests will be done
+Status Inference::RejectedStatus(ServerContextBase* context) {
+    const auto retryAfter = duration_cast<milliseconds>(_scheduler.Backlog()).count();
+    if (nullptr != context) {
+        context->AddTrailingMetadata("grpc-retry-pushback-ms", to_string(retryAfter));
     }
-    auto& model_name = model_it->first;
-    auto& model = model_it->second;
+    return Status(StatusCode::RESOURCE_EXHAUSTED,
+                  "Too many requests in flight, retry in " + to_string(retryAfter) + " ms");
+}
 
-    // Make larod calls atomic and threadsafe
-    scoped_lock lock(_mutex);
+// Run inference on a request that has been scheduled for execution
+Status Inference::RunPredict(ServerContextBase* context,
+                             const PredictRequest* request,
+                             PredictResponse* response,
+                             const CacheKey& cacheKey,
+                             const unsigned int replicaIndex) {
+    auto status = Status::CANCELLED;
+    larodError* error = nullptr;
+    uint64_t totalTime;
+    uint64_t larodTime;
+    vector<pair<FILE*, int>> inFiles;
+    vector<pair<FILE*, int>> outFiles;
+    uint32_t frame_ref;
+    const string& model_name = request->model_spec().name();
 
-    // Clear class data
-    _ppModel = nullptr;
-    _ppMap = nullptr;
-    _ppInputTensors = nullptr;
-    _ppOutputTensors = nullptr;
-    _inputTensors = nullptr;
-    _outputTensors = nullptr;
-    _ppNumInputs = 0;
-    _ppNumOutputs = 0;
-    _numInputs = 0;
-    _numOutputs = 0;
+    // Start timing
+    if (_verbose) {
+        totalTime = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    // Run on the replica picked by the scheduler, with its larod calls atomic
+    // and threadsafe. The model is held until the request is done, even if it
+    // is reloaded.
+    ModelHandle modelHandle;
+    Replica& replica = SelectReplica(replicaIndex, model_name, modelHandle);
+    larodModel* model = modelHandle.get();
+    auto transformIt = _inputTransforms.find(model_name);
+    const InputTransform* inputTransform =
+        _inputTransforms.end() != transformIt ? &transformIt->second : nullptr;
+    scoped_lock lock(replica.mutex);
+    const auto start = steady_clock::now();
+    TRACELOG << "Running on chip " << replica.chip << endl;
+
+    // Clear replica data
+    replica.ppModel = nullptr;
+    replica.ppMap = nullptr;
+    replica.ppCropMap = nullptr;
+    replica.ppInputTensors = nullptr;
+    replica.ppOutputTensors = nullptr;
+    replica.inputTensors = nullptr;
+    replica.outputTensors = nullptr;
+    replica.ppNumInputs = 0;
+    replica.ppNumOutputs = 0;
+    replica.numInputs = 0;
+    replica.numOutputs = 0;
+    frame_ref = 0 != request->stream_id() ? request->frame_reference() : 0;
 
     // Setup input tensors
-    if (!SetupInputTensors(model,
+    if (!SetupInputTensors(replica,
+                           model,
                            request->inputs(),
                            inFiles,
                            request->stream_id(),
                            frame_ref,
+                           request->has_tiling(),
+                           inputTransform,
                            error)) {
         goto predict_error;
     }
@@ -211,71 +998,55 @@ Status Inference::Predict(ServerContext* context,
     response->set_frame_reference(frame_ref);
 
     // Setup output tensors
-    if (!SetupOutputTensors(model, outFiles, error)) {
+    if (!SetupOutputTensors(replica, model, outFiles, error)) {
         goto predict_error;
     }
 
     if (_verbose) {
         TRACELOG << "Preprocessing input tensors:" << endl;
-        PrintTensorInfo(_ppInputTensors, _ppNumInputs);
+        PrintTensorInfo(replica.ppInputTensors, replica.ppNumInputs);
         TRACELOG << "Preprocessing output tensors:" << endl;
-        PrintTensorInfo(_ppOutputTensors, _ppNumOutputs);
+        PrintTensorInfo(replica.ppOutputTensors, replica.ppNumOutputs);
         TRACELOG << "inference input tensors:" << endl;
-        PrintTensorInfo(_inputTensors, _numInputs);
+        PrintTensorInfo(replica.inputTensors, replica.numInputs);
         TRACELOG << "Inference output tensors:" << endl;
-        PrintTensorInfo(_outputTensors, _numOutputs);
+        PrintTensorInfo(replica.outputTensors, replica.numOutputs);
         larodTime = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
     }
 
-    // Run preprocessing if needed
-    if (_ppNumInputs > 0) {
-        TRACELOG << "Creating preprocessing request for model " << model_name << endl;
-        ppJobReq = larodCreateJobRequest(_ppModel,
-                                         _ppInputTensors,
-                                         _ppNumInputs,
-                                         _ppOutputTensors,
-                                         _ppNumOutputs,
-                                         nullptr,
-                                         &error);
-        if (!ppJobReq) {
-            PrintError("Failed creating preprocessing job request", error);
+    if (request->has_tiling()) {
+        // Run inference tile by tile, merging the detections into the response
+        if (!PredictTiles(replica,
+                          request,
+                          response,
+                          model,
+                          model_name,
+                          outFiles,
+                          context,
+                          status,
+                          error)) {
             goto predict_error;
         }
-        ret = larodRunJob(_conn, ppJobReq, &error);
-        larodDestroyJobRequest(&ppJobReq);
-        if (!ret) {
-            PrintError("Preprocessing request failed", error);
+    } else {
+        if (!RunInference(replica, model, model_name, nullptr, context, error)) {
             goto predict_error;
         }
     }
 
-    // Request inference from larod
-    TRACELOG << "Creating inference request for model " << model_name << endl;
-    jobReq = larodCreateJobRequest(model,
-                                   _inputTensors,
-                                   _numInputs,
-                                   _outputTensors,
-                                   _numOutputs,
-                                   nullptr,  // No params used.
-                                   &error);
-    if (nullptr == jobReq) {
-        PrintError("Failed to create inference request", error);
-        goto predict_error;
-    }
-    ret = larodRunJob(_conn, jobReq, &error);
-    larodDestroyJobRequest(&jobReq);
-    if (!ret) {
-        PrintError("Inference request failed", error);
-        goto predict_error;
-    }
-
     if (_verbose) {
         larodTime =
             duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count() - larodTime;
     }
 
     // Store Larod result in response
-    if (!LarodOutputToPredictResponse(response, request->model_spec(), model, outFiles, error)) {
+    if (!request->has_tiling() && !LarodOutputToPredictResponse(replica,
+                                                                response,
+                                                                request->model_spec(),
+                                                                request->output_reduction(),
+                                                                request->float_outputs(),
+                                                                model,
+                                                                outFiles,
+                                                                error)) {
         goto predict_error;
     }
 
@@ -291,23 +1062,362 @@ Status Inference::Predict(ServerContext* context,
         TRACELOG << "Inference server overhead:  " << overheadTime << " ms ("
                  << (double)(100 * overheadTime) / totalTime << "%)" << endl;
     }
+    if (_resultCache.Enabled()) {
+        // A new frame of a stream is only known once it has been captured
+        _resultCache.Insert(cacheKey.key.empty() && 0 != request->stream_id()
+                                ? ResultCacheKey(request, model_name, frame_ref)
+                                : cacheKey.key,
+                            *response,
+                            cacheKey.generation);
+    }
     status = Status::OK;
 
 predict_error:
+    if (!status.ok() && IsAbandoned(context)) {
+        status = AbandonedStatus(context);
+    }
+
     // Cleanup
-    larodDestroyTensors(&_ppInputTensors, _ppNumInputs);
-    larodDestroyTensors(&_ppOutputTensors, _ppNumOutputs);
-    larodDestroyTensors(&_inputTensors, _numInputs);
-    larodDestroyTensors(&_outputTensors, _numOutputs);
-    larodDestroyMap(&_ppMap);
-    larodDeleteModel(_conn, _ppModel, &error);
-    larodDestroyModel(&_ppModel);
+    larodDestroyTensors(&replica.ppInputTensors, replica.ppNumInputs);
+    larodDestroyTensors(&replica.ppOutputTensors, replica.ppNumOutputs);
+    larodDestroyTensors(&replica.inputTensors, replica.numInputs);
+    larodDestroyTensors(&replica.outputTensors, replica.numOutputs);
+    larodDestroyMap(&replica.ppMap);
+    larodDestroyMap(&replica.ppCropMap);
+    larodDeleteModel(replica.conn, replica.ppModel, &error);
+    larodDestroyModel(&replica.ppModel);
     CloseTmpFiles(inFiles);
     CloseTmpFiles(outFiles);
     larodClearError(&error);
+    ReleaseReplica(replica, steady_clock::now() - start);
     return status;
 }
 
+// Describe the input and output tensors of a model, loading it if needed
+Status Inference::GetModelMetadata(ServerContextBase* context,
+                                   const GetModelMetadataRequest* request,
+                                   GetModelMetadataResponse* response) {
+    // Validate parameters
+    if (_replicas.empty()) {
+        ERRORLOG << "No valid larod connection" << endl;
+        return Status::CANCELLED;
+    }
+    if (nullptr == request || nullptr == response) {
+        ERRORLOG << "Unexpected NULL request or response in parameter" << endl;
+        return Status::CANCELLED;
+    }
+    if (0 == request->metadata_field_size()) {
+        return Status(StatusCode::INVALID_ARGUMENT, "No metadata_field in request");
+    }
+
+    const string& model_name = request->model_spec().name();
+    TRACELOG << "Metadata request for " << model_name << endl;
+    if (!PlaceModel(model_name)) {
+        return Status(StatusCode::NOT_FOUND, "Could not load model " + model_name);
+    }
+    scoped_lock lock(_replicaMutex);
+    auto metadata = _modelMetadata.find(model_name);
+    if (_modelMetadata.end() == metadata) {
+        return Status(StatusCode::INTERNAL, "No metadata for model " + model_name);
+    }
+
+    for (auto& field : request->metadata_field()) {
+        auto value = metadata->second.find(field);
+        if (metadata->second.end() == value) {
+            return Status(StatusCode::INVALID_ARGUMENT,
+                          "Metadata field " + field + " is not supported");
+        }
+        (*response->mutable_metadata())[field] = value->second;
+    }
+    response->mutable_model_spec()->CopyFrom(request->model_spec());
+    return Status::OK;
+}
+
+// Key identifying the result of a request in the result cache, which is empty
+// if the result can not be cached. Images from a stream are identified by
+// their frame reference and other inputs by a hash of their content.
+string Inference::ResultCacheKey(const PredictRequest* request,
+                                 const string& modelName,
+                                 const uint32_t frameRef) {
+    stringstream key;
+    key << modelName << '\n' << request->output_reduction() << request->float_outputs() << '\n';
+    if (request->has_tiling()) {
+        key << request->tiling().ShortDebugString() << '\n';
+    }
+
+    if (0 != request->stream_id()) {
+        if (0 == frameRef) {
+            return "";
+        }
+        key << "frame " << request->stream_id() << ':' << frameRef;
+        return key.str();
+    }
+
+    // Inputs are hashed in name order, as map iteration order is unspecified
+    map<string, const TensorProto*> inputs;
+    for (auto& [name, tensor] : request->inputs()) {
+        inputs[name] = &tensor;
+    }
+    for (auto& [name, tensor] : inputs) {
+        uint64_t hash = ResultCache::Hash(name.data(), name.size(), tensor->dtype());
+        for (auto& dim : tensor->tensor_shape().dim()) {
+            const int64_t size = dim.size();
+            hash = ResultCache::Hash(&size, sizeof(size), hash);
+        }
+        if (tensor->dtype() == tensorflow::DataType::DT_STRING) {
+            // Shared memory files may be rewritten under the same name
+            return "";
+        }
+        const string& content = tensor->tensor_content();
+        if (content.empty()) {
+            const string serialized = tensor->SerializeAsString();
+            hash = ResultCache::Hash(serialized.data(), serialized.size(), hash);
+        } else {
+            hash = ResultCache::Hash(content.data(), content.size(), hash);
+        }
+        key << hex << hash << ' ';
+    }
+    return key.str();
+}
+
+// Run preprocessing, if needed, followed by inference. Jobs are not started
+// for requests that have been abandoned by the client.
+// NB! No cleanup is performed here upon failure. The calling function is
+//     expected to handle that.
+bool Inference::RunInference(Replica& replica,
+                             larodModel*& model,
+                             const string& modelName,
+                             larodMap* ppParams,
+                             const ServerContextBase* context,
+                             larodError*& error) {
+    bool ret;
+
+    // Run preprocessing if needed
+    if (replica.ppNumInputs > 0) {
+        if (IsAbandoned(context)) {
+            TRACELOG << "Request abandoned before preprocessing" << endl;
+            droppedBeforePreprocessingMetric.Add();
+            return false;
+        }
+
+        TRACELOG << "Creating preprocessing request for model " << modelName << endl;
+        larodJobRequest* ppJobReq = larodCreateJobRequest(replica.ppModel,
+                                                          replica.ppInputTensors,
+                                                          replica.ppNumInputs,
+                                                          replica.ppOutputTensors,
+                                                          replica.ppNumOutputs,
+                                                          ppParams,
+                                                          &error);
+        if (!ppJobReq) {
+            PrintError("Failed creating preprocessing job request", error);
+            return false;
+        }
+        ret = larodRunJob(replica.conn, ppJobReq, &error);
+        larodDestroyJobRequest(&ppJobReq);
+        if (!ret) {
+            PrintError("Preprocessing request failed", error);
+            return false;
+        }
+    }
+
+    // Request inference from larod
+    if (IsAbandoned(context)) {
+        TRACELOG << "Request abandoned before inference" << endl;
+        droppedBeforeInferenceMetric.Add();
+        return false;
+    }
+    TRACELOG << "Creating inference request for model " << modelName << endl;
+    larodJobRequest* jobReq = larodCreateJobRequest(model,
+                                                    replica.inputTensors,
+                                                    replica.numInputs,
+                                                    replica.outputTensors,
+                                                    replica.numOutputs,
+                                                    nullptr,  // No params used.
+                                                    &error);
+    if (nullptr == jobReq) {
+        PrintError("Failed to create inference request", error);
+        return false;
+    }
+    ret = larodRunJob(replica.conn, jobReq, &error);
+    larodDestroyJobRequest(&jobReq);
+    if (!ret) {
+        PrintError("Inference request failed", error);
+        return false;
+    }
+    return true;
+}
+
+// Run inference on overlapping tiles of the input image and merge the
+// detections of all tiles into the response. Invalid tiling parameters are
+// returned in status.
+// NB! No cleanup is performed here upon failure. The calling function is
+//     expected to handle that.
+bool Inference::PredictTiles(Replica& replica,
+                             const PredictRequest* request,
+                             PredictResponse* response,
+                             larodModel*& model,
+                             const string& modelName,
+                             vector<pair<FILE*, int>>& outFiles,
+                             const ServerContextBase* context,
+                             Status& status,
+                             larodError*& error) {
+    const auto& tiling = request->tiling();
+    const float mergeThreshold = tiling.merge_threshold() > 0 ? tiling.merge_threshold() : 0.5f;
+    const size_t numDetectionOutputs = 4;
+
+    // Verify that this is a detection model
+    if (1 != replica.numInputs || 0 == replica.ppNumInputs ||
+        numDetectionOutputs != replica.numOutputs) {
+        ERRORLOG << "Tiling requires a single input detection model" << endl;
+        return false;
+    }
+    size_t maxDetections = 0;
+    for (size_t i = 0; i < numDetectionOutputs; i++) {
+        auto dataType = larodGetTensorDataType(replica.outputTensors[i], &error);
+        auto dims = larodGetTensorDims(replica.outputTensors[i], &error);
+        if (LAROD_TENSOR_DATA_TYPE_FLOAT32 != dataType || nullptr == dims) {
+            ERRORLOG << "Tiling requires TFLite_Detection_PostProcess outputs" << endl;
+            return false;
+        }
+        if (0 == i) {
+            if (3 != dims->len || 4 != dims->dims[2]) {
+                ERRORLOG << "Tiling requires TFLite_Detection_PostProcess outputs" << endl;
+                return false;
+            }
+            maxDetections = dims->dims[1];
+        }
+    }
+
+    // The image is interleaved, as required for preprocessing
+    const auto& shape = request->inputs().begin()->second.tensor_shape();
+    const larodTensorDims* modelDims = larodGetTensorDims(replica.inputTensors[0], &error);
+    if (4 != shape.dim_size() || nullptr == modelDims) {
+        PrintError("Failed to get tensor data dimensions", error);
+        return false;
+    }
+    const larodTensorLayout modelLayout = larodGetTensorLayout(replica.inputTensors[0], &error);
+    if (LAROD_TENSOR_LAYOUT_INVALID == modelLayout) {
+        PrintError("Failed to get tensor layout", error);
+        return false;
+    }
+    const ImageShape modelShape =
+        GetImageShape(*modelDims, LAROD_TENSOR_LAYOUT_NCHW == modelLayout);
+    const int imageHeight = shape.dim(1).size();
+    const int imageWidth = shape.dim(2).size();
+
+    // Tiles must advance by more than half a tile, and their number is bounded
+    if (tiling.overlap() >= min(modelShape.width, modelShape.height) / 2) {
+        ERRORLOG << "Tiling overlap " << tiling.overlap() << " is not below half a tile" << endl;
+        status = Status(StatusCode::INVALID_ARGUMENT, "Tiling overlap must be below half a tile");
+        return false;
+    }
+    const vector<Tile> tiles = ComputeTiles(imageWidth,
+                                            imageHeight,
+                                            modelShape.width,
+                                            modelShape.height,
+                                            static_cast<int>(tiling.overlap()));
+    if (MAX_TILES < tiles.size()) {
+        ERRORLOG << "Image needs " << tiles.size() << " tiles, more than " << MAX_TILES << endl;
+        status = Status(StatusCode::INVALID_ARGUMENT,
+                        "Image needs more than " + to_string(MAX_TILES) + " tiles");
+        return false;
+    }
+    TRACELOG << "Splitting " << imageWidth << "x" << imageHeight << " image into "
+             << tiles.size() << " tiles" << endl;
+
+    replica.ppCropMap = larodCreateMap(&error);
+    if (!replica.ppCropMap) {
+        PrintError("Could not create crop larodMap", error);
+        return false;
+    }
+
+    // The same tensors and buffers are reused for every tile
+    vector<float> boxes(4 * maxDetections);
+    vector<float> classes(maxDetections);
+    vector<float> scores(maxDetections);
+    float count = 0;
+    vector<Detection> detections;
+    for (const Tile& tile : tiles) {
+        if (!larodMapSetIntArr4(replica.ppCropMap,
+                                "image.input.crop",
+                                tile.x,
+                                tile.y,
+                                tile.width,
+                                tile.height,
+                                &error)) {
+            PrintError("Failed setting crop parameters", error);
+            return false;
+        }
+        if (!RunInference(replica, model, modelName, replica.ppCropMap, context, error)) {
+            return false;
+        }
+
+        if (0 > pread(outFiles[0].second, boxes.data(), boxes.size() * sizeof(float), 0) ||
+            0 > pread(outFiles[1].second, classes.data(), classes.size() * sizeof(float), 0) ||
+            0 > pread(outFiles[2].second, scores.data(), scores.size() * sizeof(float), 0) ||
+            0 > pread(outFiles[3].second, &count, sizeof(float), 0)) {
+            PrintErrorWithErrno("Failed to read data from output file descriptor");
+            return false;
+        }
+
+        const size_t numDetections = min(static_cast<size_t>(count), maxDetections);
+        for (size_t i = 0; i < numDetections; i++) {
+            if (scores[i] < tiling.score_threshold()) {
+                continue;
+            }
+            Detection detection{boxes[4 * i],
+                                boxes[4 * i + 1],
+                                boxes[4 * i + 2],
+                                boxes[4 * i + 3],
+                                classes[i],
+                                scores[i]};
+            detections.push_back(TileToImage(detection, tile, imageWidth, imageHeight));
+        }
+    }
+
+    vector<Detection> merged = MergeDetections(detections, mergeThreshold);
+    TRACELOG << "Merged " << detections.size() << " detections into " << merged.size() << endl;
+
+    // Store the merged detections in the same format as the model outputs
+    const size_t numMerged = merged.size();
+    boxes.resize(4 * numMerged);
+    classes.resize(numMerged);
+    scores.resize(numMerged);
+    for (size_t i = 0; i < numMerged; i++) {
+        boxes[4 * i] = merged[i].ymin;
+        boxes[4 * i + 1] = merged[i].xmin;
+        boxes[4 * i + 2] = merged[i].ymax;
+        boxes[4 * i + 3] = merged[i].xmax;
+        classes[i] = merged[i].classId;
+        scores[i] = merged[i].score;
+    }
+    count = numMerged;
+
+    const vector<vector<size_t>> dims = {{1, numMerged, 4}, {1, numMerged}, {1, numMerged}, {1}};
+    const float* data[] = {boxes.data(), classes.data(), scores.data(), &count};
+    for (size_t i = 0; i < numDetectionOutputs; i++) {
+        const char* tensorName = larodGetTensorName(replica.outputTensors[i], &error);
+        if (nullptr == tensorName) {
+            PrintError("Could not get name of tensor", error);
+            return false;
+        }
+        TensorProto& output = (*response->mutable_outputs())[tensorName];
+        output.set_dtype(DataType::DT_FLOAT);
+        size_t size = sizeof(float);
+        for (auto dim : dims[i]) {
+            auto tensorDim = output.mutable_tensor_shape()->add_dim();
+            tensorDim->set_size(dim);
+            tensorDim->set_name("size");
+            size *= dim;
+        }
+        output.set_tensor_content(data[i], size);
+        output.set_version_number(0);
+    }
+
+    response->mutable_model_spec()->CopyFrom(request->model_spec());
+    return true;
+}
+
 // Convert from TensorFlow to larod datatype
 inline const larodTensorDataType TfToLarodDataType(const DataType& dataType) {
     switch (dataType) {
@@ -331,16 +1441,12 @@ inline const larodTensorDataType TfToLarodDataType(const DataType& dataType) {
             return LAROD_TENSOR_DATA_TYPE_UINT64;
         case DataType::DT_INT64:
             return LAROD_TENSOR_DATA_TYPE_INT64;
-        /*
-        case DataType::DT_:
-          return LAROD_TENSOR_DATA_TYPE_FLOAT16;
-        */
+        case DataType::DT_HALF:
+            return LAROD_TENSOR_DATA_TYPE_FLOAT16;
         case DataType::DT_FLOAT:
             return LAROD_TENSOR_DATA_TYPE_FLOAT32;
-        /*
-        case DataType::DT_:
-          return LAROD_TENSOR_DATA_TYPE_FLOAT64;
-        */
+        case DataType::DT_DOUBLE:
+            return LAROD_TENSOR_DATA_TYPE_FLOAT64;
         default:
         case DataType::DT_INVALID:
             return LAROD_TENSOR_DATA_TYPE_INVALID;
@@ -370,16 +1476,12 @@ inline const DataType LarodToTfDataType(const larodTensorDataType& dataType) {
             return DataType::DT_UINT64;
         case LAROD_TENSOR_DATA_TYPE_INT64:
             return DataType::DT_INT64;
-        /*
         case LAROD_TENSOR_DATA_TYPE_FLOAT16:
-          return DataType::DT_;
-        */
+            return DataType::DT_HALF;
         case LAROD_TENSOR_DATA_TYPE_FLOAT32:
             return DataType::DT_FLOAT;
-        /*
         case LAROD_TENSOR_DATA_TYPE_FLOAT64:
-          return DataType::DT_;
-        */
+            return DataType::DT_DOUBLE;
         case LAROD_TENSOR_DATA_TYPE_INVALID:
         default:
             return DataType::DT_INVALID;
@@ -663,10 +1765,11 @@ void Inference::CloseTmpFiles(vector<pair<FILE*, int>>& tmpFiles) {
     tmpFiles.clear();
 }
 
-bool Inference::LoadModel(larodConnection& conn,
+// Load a model file on the chip of a replica
+bool Inference::LoadModel(Replica& replica,
                           const char* modelFile,
-                          const larodChip chip,
-                          const larodAccess access) {
+                          const larodAccess access,
+                          ModelHandle& model) {
     string modelName;
     larodModel* loadedModel;
     larodError* error = nullptr;
@@ -692,7 +1795,8 @@ bool Inference::LoadModel(larodConnection& conn,
         modelName.assign(basename(modelFile));
     }
 
-    loadedModel = larodLoadModel(&conn, fd, chip, access, modelName.c_str(), nullptr, &error);
+    loadedModel =
+        larodLoadModel(replica.conn, fd, replica.chip, access, modelName.c_str(), nullptr, &error);
     if (nullptr == loadedModel) {
         stringstream ss;
         ss << "Failed to load model " << modelName.c_str();
@@ -703,15 +1807,133 @@ bool Inference::LoadModel(larodConnection& conn,
     }
 
     fclose(fpModel);
-    _models.insert(make_pair(modelFile, loadedModel));
+    model = ModelHandle(loadedModel, [this, conn = replica.conn](larodModel* model) {
+        larodError* error = nullptr;
+        if (!larodDeleteModel(conn, model, &error)) {
+            PrintError("Failed to delete model", error);
+            larodClearError(&error);
+        }
+        larodDestroyModel(&model);
+    });
     return true;
 }
 
-bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
+// Build the metadata of a loaded model once, so that GetModelMetadata does
+// not need to query larod. Tensors are described as on the first replica
+// that has the model, since the model is the same on all of them.
+// NB! Must be called with _replicaMutex held
+bool Inference::CacheModelMetadata(const string& modelFile) {
+    larodModel* model = nullptr;
+    for (auto& replica : _replicas) {
+        auto it = replica.models.find(modelFile);
+        if (replica.models.end() != it) {
+            model = it->second.get();
+            break;
+        }
+    }
+    if (nullptr == model) {
+        return false;
+    }
+
+    larodError* error = nullptr;
+    size_t numInputs = 0;
+    size_t numOutputs = 0;
+    serving::SignatureDefMap signatures;
+    serving::TensorLayoutMap layouts;
+    auto& signature = (*signatures.mutable_signature_def())["serving_default"];
+    bool ret = false;
+
+    larodTensor** inputs = larodCreateModelInputs(model, &numInputs, &error);
+    larodTensor** outputs = larodCreateModelOutputs(model, &numOutputs, &error);
+    if (nullptr == inputs || nullptr == outputs) {
+        PrintError("Failed retrieving tensors for model metadata", error);
+        goto metadata_end;
+    }
+    signature.set_method_name("tensorflow/serving/predict");
+    if (!DescribeTensors(inputs,
+                         numInputs,
+                         "input",
+                         *signature.mutable_inputs(),
+                         *layouts.mutable_inputs(),
+                         error) ||
+        !DescribeTensors(outputs,
+                         numOutputs,
+                         "output",
+                         *signature.mutable_outputs(),
+                         *layouts.mutable_outputs(),
+                         error)) {
+        goto metadata_end;
+    }
+
+    _modelMetadata[modelFile]["signature_def"].PackFrom(signatures);
+    _modelMetadata[modelFile]["tensor_layout"].PackFrom(layouts);
+    ret = true;
+
+metadata_end:
+    larodDestroyTensors(&inputs, numInputs);
+    larodDestroyTensors(&outputs, numOutputs);
+    larodClearError(&error);
+    return ret;
+}
+
+// Add the name, data type, shape, layout and pitches of tensors to metadata.
+// Tensors without a name are named by their prefix and index.
+bool Inference::DescribeTensors(larodTensor** tensors,
+                                const size_t numTensors,
+                                const char* prefix,
+                                google::protobuf::Map<string, TensorInfo>& infos,
+                                google::protobuf::Map<string, TensorLayout>& layouts,
+                                larodError*& error) {
+    for (size_t i = 0; i < numTensors; i++) {
+        const char* tensorName = larodGetTensorName(tensors[i], &error);
+        const larodTensorDims* dims = larodGetTensorDims(tensors[i], &error);
+        const larodTensorPitches* pitches = larodGetTensorPitches(tensors[i], &error);
+        const larodTensorDataType dataType = larodGetTensorDataType(tensors[i], &error);
+        const larodTensorLayout layout = larodGetTensorLayout(tensors[i], &error);
+        if (nullptr == tensorName || nullptr == dims || nullptr == pitches ||
+            LAROD_TENSOR_DATA_TYPE_INVALID == dataType || LAROD_TENSOR_LAYOUT_INVALID == layout) {
+            PrintError("Failed to describe tensor", error);
+            return false;
+        }
+        const string name = '\0' != tensorName[0] ? tensorName : prefix + to_string(i);
+
+        TensorInfo& info = infos[name];
+        info.set_name(name);
+        info.set_dtype(LarodToTfDataType(dataType));
+        for (size_t j = 0; j < dims->len; j++) {
+            info.mutable_tensor_shape()->add_dim()->set_size(dims->dims[j]);
+        }
+
+        TensorLayout& tensorLayout = layouts[name];
+        tensorLayout.set_name(name);
+        switch (layout) {
+            case LAROD_TENSOR_LAYOUT_NHWC:
+                tensorLayout.set_layout("NHWC");
+                break;
+            case LAROD_TENSOR_LAYOUT_NCHW:
+                tensorLayout.set_layout("NCHW");
+                break;
+            case LAROD_TENSOR_LAYOUT_420SP:
+                tensorLayout.set_layout("420SP");
+                break;
+            default:
+                break;
+        }
+        for (size_t j = 0; j < pitches->len; j++) {
+            tensorLayout.add_pitches(pitches->pitches[j]);
+        }
+    }
+    return true;
+}
+
+bool Inference::SetupPreprocessing(Replica& replica,
+                                   const TensorProto& tp,
                                    larodTensor* tensor,
                                    vector<pair<FILE*, int>>& inFiles,
                                    u_int32_t stream,
                                    uint32_t& frame_ref,
+                                   const bool forcePreprocessing,
+                                   const InputTransform* transform,
                                    larodError*& error) {
     void* larodInputAddr = MAP_FAILED;
 
@@ -738,14 +1960,24 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
     }
     TRACELOG << "Model size: " << modelSize << endl;
 
-    // LAROD_TENSOR_LAYOUT_NHWC format assumed
-    int requestHeight = dims.dims[1];
-    int requestWidth = dims.dims[2];
-    int modelHeight = modelDims->dims[1];
-    int modelWidth = modelDims->dims[2];
-    ;
-    TRACELOG << "Request image size " << requestWidth << "x" << requestHeight << endl;
-    TRACELOG << "Model image size " << modelWidth << "x" << modelHeight << endl;
+    // Images are NHWC or NCHW, the request may be in another layout than the model
+    const larodTensorLayout modelLayout = larodGetTensorLayout(tensor, &error);
+    if (LAROD_TENSOR_LAYOUT_INVALID == modelLayout) {
+        PrintError("Failed to get tensor layout", error);
+        return false;
+    }
+    const bool modelPlanar = LAROD_TENSOR_LAYOUT_NCHW == modelLayout;
+    const bool requestPlanar = IsPlanarRequest(dims, *modelDims, modelPlanar);
+    const ImageShape requestShape = GetImageShape(dims, requestPlanar);
+    const ImageShape modelShape = GetImageShape(*modelDims, modelPlanar);
+    int requestHeight = requestShape.height;
+    int requestWidth = requestShape.width;
+    int modelHeight = modelShape.height;
+    int modelWidth = modelShape.width;
+    TRACELOG << "Request image size " << requestWidth << "x" << requestHeight
+             << (requestPlanar ? " planar" : "") << endl;
+    TRACELOG << "Model image size " << modelWidth << "x" << modelHeight
+             << (modelPlanar ? " planar" : "") << endl;
 
     bool isMemoryMappedFile = tp.dtype() == tensorflow::DataType::DT_STRING;
     bool isRequestForImageFromStream = stream != 0;
@@ -754,7 +1986,7 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
     FILE* tmpFile = nullptr;
     int tmpFd = -1;
     if (isMemoryMappedFile) {
-        string filename = tp.string_val(0);
+        const string& filename = tp.string_val(0);
         TRACELOG << "Input file: " << filename << endl;
         tmpFd = shm_open(filename.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
         if (tmpFd < 0) {
@@ -764,11 +1996,23 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
     } else if (isRequestForImageFromStream) {
         TRACELOG << "Got request to use image from stream " << stream << endl;
 
+        // Use the requested frame if any, otherwise capture a new one. The
+        // frame is held until its data is copied, as other calls may evict it.
         size_t size;
         void* data;
-        if (!_captureService->GetImgDataFromStream(stream, &data, size, frame_ref)) {
-            ERRORLOG << "Could not get data from stream" << endl;
-            return false;
+        shared_ptr<SharedFrame> frame;
+        if (0 != frame_ref) {
+            frame = _captureService->GetImgDataFromSavedFrame(stream, frame_ref, &data, size);
+            if (!frame) {
+                ERRORLOG << "Could not get frame " << frame_ref << " from stream" << endl;
+                return false;
+            }
+        } else {
+            frame = _captureService->GetImgDataFromStream(stream, &data, size, frame_ref);
+            if (!frame) {
+                ERRORLOG << "Could not get data from stream" << endl;
+                return false;
+            }
         }
 
         TRACELOG << "Got data of size " << size << endl;
@@ -779,18 +2023,57 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
             return false;
         }
     } else {
-        TRACELOG << "Input ByteSize: " << tp.tensor_content().size() << endl;
-        if (!CreateTmpFile(tmpFile,
-                           tmpFd,
-                           tp.tensor_content().data(),
-                           tp.tensor_content().size())) {
+        // Values may also be given in the repeated field of the data type
+        const string* content = &tp.tensor_content();
+        string packed;
+        if (content->empty()) {
+            if (!PackTensorValues(tp, requestSize, packed)) {
+                ERRORLOG << "Unsupported values in input tensor of type "
+                         << DataType_Name(tp.dtype()) << endl;
+                return false;
+            }
+            content = &packed;
+        }
+
+        // Single precision inputs are normalized, quantized or converted to
+        // half precision when the model needs it
+        const larodTensorDataType modelType = larodGetTensorDataType(tensor, &error);
+        if (LAROD_TENSOR_DATA_TYPE_INVALID == modelType) {
+            PrintError("Failed to get tensor data type", error);
             return false;
         }
+        if (DataType::DT_FLOAT == tp.dtype() &&
+            (nullptr != transform || LAROD_TENSOR_DATA_TYPE_FLOAT16 == modelType)) {
+            if (!ConvertFloatInput(reinterpret_cast<const float*>(content->data()),
+                                   content->size() / sizeof(float),
+                                   modelType,
+                                   transform,
+                                   tmpFile,
+                                   tmpFd)) {
+                return false;
+            }
+        } else {
+            TRACELOG << "Input ByteSize: " << content->size() << endl;
+            if (!CreateTmpFile(tmpFile, tmpFd, content->data(), content->size())) {
+                return false;
+            }
+        }
     }
     inFiles.push_back(make_pair(tmpFile, tmpFd));
 
     // Check if resize is needed
-    if (requestSize == modelSize && requestWidth == modelWidth && requestHeight == modelHeight) {
+    if (!forcePreprocessing && requestSize == modelSize && requestWidth == modelWidth &&
+        requestHeight == modelHeight) {
+        if (4 == dims.len && requestPlanar != modelPlanar && !isRequestForImageFromStream &&
+            !TransposeInput(tensor,
+                            requestHeight * requestWidth,
+                            requestShape.channels,
+                            modelPlanar,
+                            tmpFd,
+                            inFiles,
+                            error)) {
+            return false;
+        }
         if (!larodSetTensorFd(tensor, tmpFd, &error)) {
             PrintError("Failed to set input tensor file descriptor", error);
             return false;
@@ -798,9 +2081,14 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
         return true;
     }
 
+    if (requestPlanar) {
+        ERRORLOG << "Only interleaved images can be resized" << endl;
+        return false;
+    }
+
     // Create preprocessing maps
-    _ppMap = larodCreateMap(&error);
-    if (!_ppMap) {
+    replica.ppMap = larodCreateMap(&error);
+    if (!replica.ppMap) {
         PrintError("Could not create preprocessing larodMap", error);
         return false;
     }
@@ -809,39 +2097,45 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
     // other formats in the stream.
     const char* inputFormat = isRequestForImageFromStream ? "nv12" : "rgb-interleaved";
 
-    if (!larodMapSetStr(_ppMap, "image.input.format", inputFormat, &error)) {
+    if (!larodMapSetStr(replica.ppMap, "image.input.format", inputFormat, &error)) {
         PrintError("Failed setting preprocessing parameters", error);
         return false;
     }
 
-    if (!larodMapSetIntArr2(_ppMap, "image.input.size", requestWidth, requestHeight, &error)) {
+    if (!larodMapSetIntArr2(
+            replica.ppMap, "image.input.size", requestWidth, requestHeight, &error)) {
         PrintError("Failed setting preprocessing parameters", error);
         return false;
     }
-    if (!larodMapSetStr(_ppMap, "image.output.format", "rgb-interleaved", &error)) {
+    // Planar model inputs are written directly by the preprocessing job
+    if (!larodMapSetStr(replica.ppMap,
+                        "image.output.format",
+                        modelPlanar ? "rgb-planar" : "rgb-interleaved",
+                        &error)) {
         PrintError("Failed setting preprocessing parameters", error);
         return false;
     }
-    if (!larodMapSetIntArr2(_ppMap, "image.output.size", modelWidth, modelHeight, &error)) {
+    if (!larodMapSetIntArr2(replica.ppMap, "image.output.size", modelWidth, modelHeight, &error)) {
         PrintError("Failed setting preprocessing parameters", error);
         return false;
     }
 
-    _ppModel =
-        larodLoadModel(_conn, -1, LAROD_CHIP_LIBYUV, LAROD_ACCESS_PRIVATE, "", _ppMap, &error);
-    if (!_ppModel) {
+    replica.ppModel = larodLoadModel(
+        replica.conn, -1, LAROD_CHIP_LIBYUV, LAROD_ACCESS_PRIVATE, "", replica.ppMap, &error);
+    if (!replica.ppModel) {
         PrintError("Unable to load preprocessing model", error);
         return false;
     }
 
     // Create preprocessing tensors
-    _ppInputTensors = larodCreateModelInputs(_ppModel, &_ppNumInputs, &error);
-    if (!_ppInputTensors) {
+    replica.ppInputTensors = larodCreateModelInputs(replica.ppModel, &replica.ppNumInputs, &error);
+    if (!replica.ppInputTensors) {
         PrintError("Failed retrieving preprocessing input tensors", error);
         return false;
     }
-    _ppOutputTensors = larodCreateModelOutputs(_ppModel, &_ppNumOutputs, &error);
-    if (!_ppOutputTensors) {
+    replica.ppOutputTensors =
+        larodCreateModelOutputs(replica.ppModel, &replica.ppNumOutputs, &error);
+    if (!replica.ppOutputTensors) {
         PrintError("Failed retrieving output tensors", error);
         return false;
     }
@@ -855,11 +2149,11 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
     inFiles.push_back(make_pair(larodInputFile, larodInputFd));
 
     // Set preprocessing buffers
-    if (!larodSetTensorFd(_ppInputTensors[0], tmpFd, &error)) {
+    if (!larodSetTensorFd(replica.ppInputTensors[0], tmpFd, &error)) {
         PrintError("Failed to set preprocessing input tensor file descriptor", error);
         return false;
     }
-    if (!larodSetTensorFd(_ppOutputTensors[0], larodInputFd, &error)) {
+    if (!larodSetTensorFd(replica.ppOutputTensors[0], larodInputFd, &error)) {
         PrintError("Failed to set preprocessing output tensor file descriptor", error);
         return false;
     }
@@ -871,43 +2165,164 @@ bool Inference::SetupPreprocessing(tensorflow::TensorProto tp,
     return true;
 }
 
+// Write single precision input values to a new temporary file, in the data type
+// of the model input. The values are transformed directly into the mapped file.
+bool Inference::ConvertFloatInput(const float* values,
+                                  const size_t count,
+                                  const larodTensorDataType modelType,
+                                  const InputTransform* transform,
+                                  FILE*& file,
+                                  int& fd) {
+    const bool quantize =
+        LAROD_TENSOR_DATA_TYPE_UINT8 == modelType || LAROD_TENSOR_DATA_TYPE_INT8 == modelType;
+    if (quantize && (nullptr == transform || 0 == transform->scale)) {
+        ERRORLOG << "No quantization configured for " << DATA_TYPES[modelType] << " input"
+                 << endl;
+        return false;
+    }
+    if (!quantize && LAROD_TENSOR_DATA_TYPE_FLOAT32 != modelType &&
+        LAROD_TENSOR_DATA_TYPE_FLOAT16 != modelType) {
+        ERRORLOG << "Can not convert float input to " << DATA_TYPES[modelType] << endl;
+        return false;
+    }
+
+    const size_t size = count * LarodDataTypeSize(modelType);
+    TRACELOG << "Input ByteSize: " << size << endl;
+    if (!CreateTmpFile(file, fd, nullptr, 0)) {
+        return false;
+    }
+    if (0 == size) {
+        return true;
+    }
+    void* data = MAP_FAILED;
+    if (0 == ftruncate(fd, size)) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (MAP_FAILED == data) {
+        PrintErrorWithErrno("Failed to map input file");
+        CloseTmpFile(file, fd);
+        return false;
+    }
+
+    vector<float> normalized;
+    switch (modelType) {
+        case LAROD_TENSOR_DATA_TYPE_UINT8:
+            QuantizeFloat(values, count, *transform, static_cast<uint8_t*>(data));
+            break;
+        case LAROD_TENSOR_DATA_TYPE_INT8:
+            QuantizeFloat(values, count, *transform, static_cast<int8_t*>(data));
+            break;
+        case LAROD_TENSOR_DATA_TYPE_FLOAT16:
+            if (nullptr != transform) {
+                normalized.resize(count);
+                NormalizeFloat(values, count, *transform, normalized.data());
+                values = normalized.data();
+            }
+            FloatToHalf(values, count, static_cast<uint16_t*>(data));
+            break;
+        default:
+            NormalizeFloat(values, count, *transform, static_cast<float*>(data));
+            break;
+    }
+    munmap(data, size);
+    return true;
+}
+
+// Transpose an input image between interleaved and planar layout, into a new
+// temporary file that replaces the given file descriptor
+// NB! No cleanup is performed here upon failure. The calling function is
+//     expected to handle that.
+bool Inference::TransposeInput(larodTensor* tensor,
+                               const size_t pixels,
+                               const size_t channels,
+                               const bool toPlanar,
+                               int& fd,
+                               vector<pair<FILE*, int>>& inFiles,
+                               larodError*& error) {
+    const larodTensorDataType dataType = larodGetTensorDataType(tensor, &error);
+    if (LAROD_TENSOR_DATA_TYPE_INVALID == dataType) {
+        PrintError("Failed to get tensor data type", error);
+        return false;
+    }
+    const size_t elementSize = LarodDataTypeSize(dataType);
+    const size_t size = pixels * channels * elementSize;
+    TRACELOG << "Transposing input to " << (toPlanar ? "planar" : "interleaved") << endl;
+
+    FILE* file = nullptr;
+    int outFd = -1;
+    if (!CreateTmpFile(file, outFd, nullptr, 0)) {
+        return false;
+    }
+    inFiles.push_back(make_pair(file, outFd));
+    if (0 != ftruncate(outFd, size)) {
+        PrintErrorWithErrno("Failed to resize transposed input file");
+        return false;
+    }
+
+    void* in = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == in) {
+        PrintErrorWithErrno("Failed to map input file");
+        return false;
+    }
+    void* out = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, outFd, 0);
+    if (MAP_FAILED == out) {
+        PrintErrorWithErrno("Failed to map transposed input file");
+        munmap(in, size);
+        return false;
+    }
+    const bool transposed = toPlanar ? InterleavedToPlanar(in, pixels, channels, elementSize, out)
+                                     : PlanarToInterleaved(in, pixels, channels, elementSize, out);
+    munmap(out, size);
+    munmap(in, size);
+    if (!transposed) {
+        ERRORLOG << "Can not transpose input of type " << DATA_TYPES[dataType] << endl;
+        return false;
+    }
+    fd = outFd;
+    return true;
+}
+
 // Create input tensors
 // NB! No cleanup is performed here upon failure. The calling function is
 //     expected to handle that.
-bool Inference::SetupInputTensors(larodModel*& model,
+bool Inference::SetupInputTensors(Replica& replica,
+                                  larodModel*& model,
                                   const google::protobuf::Map<string, TensorProto>& inputs,
                                   vector<pair<FILE*, int>>& inFiles,
                                   const u_int32_t stream,
                                   uint32_t& frame_ref,
+                                  const bool forcePreprocessing,
+                                  const InputTransform* transform,
                                   larodError*& error) {
     // Setup input tensors
-    _inputTensors = larodCreateModelInputs(model, &_numInputs, &error);
-    if (nullptr == _inputTensors) {
+    replica.inputTensors = larodCreateModelInputs(model, &replica.numInputs, &error);
+    if (nullptr == replica.inputTensors) {
         PrintError("Failed retrieving input tensors", error);
         return false;
     }
 
-    TRACELOG << "Model NumInputs: " << _numInputs << endl;
-    if (inputs.size() != _numInputs) {
+    TRACELOG << "Model NumInputs: " << replica.numInputs << endl;
+    if (inputs.size() != replica.numInputs) {
         ERRORLOG << "Predict request has " << inputs.size() << " inputs but model has "
-                 << _numInputs << endl;
+                 << replica.numInputs << endl;
         return false;
     }
 
     int i = 0;
-    for (auto& [input_name, tpa] : inputs) {
-        tensorflow::TensorProto tp = tpa;
+    // Inputs are used in place, the request is never copied
+    for (auto& [input_name, tp] : inputs) {
         TRACELOG << "Input name: " << input_name << endl;
-        if (!SetupPreprocessing(tp, _inputTensors[i], inFiles, stream, frame_ref, error)) {
+        if (!SetupPreprocessing(replica,
+                                tp,
+                                replica.inputTensors[i],
+                                inFiles,
+                                stream,
+                                frame_ref,
+                                forcePreprocessing,
+                                transform,
+                                error)) {
             return false;
         }
-
-        //    const larodTensorLayout setLayout = LAROD_TENSOR_LAYOUT_NHWC;
-        //    if (!larodSetTensorLayout(inputTensors[i], setLayout, &error)) {
-        //      PrintError("Failed to set tensor layout", error);
-        //      return false;
-        //    }
-
         i++;
     }
     return true;
@@ -916,30 +2331,31 @@ bool Inference::SetupInputTensors(larodModel*& model,
 // Create output tensors
 // NB! No cleanup is performed here upon failure. The calling function is
 //     expected to handle that.
-bool Inference::SetupOutputTensors(larodModel*& model,
+bool Inference::SetupOutputTensors(Replica& replica,
+                                   larodModel*& model,
                                    vector<pair<FILE*, int>>& outFiles,
                                    larodError*& error) {
     FILE* tmpFile = nullptr;
     int tmpFd = -1;
 
     // Setup output tensors
-    _outputTensors = larodCreateModelOutputs(model, &_numOutputs, &error);
-    if (nullptr == _outputTensors) {
+    replica.outputTensors = larodCreateModelOutputs(model, &replica.numOutputs, &error);
+    if (nullptr == replica.outputTensors) {
         PrintError("Failed retrieving input tensors", error);
         return false;
     }
-    if (_numOutputs < 1) {
+    if (replica.numOutputs < 1) {
         ERRORLOG << "Tensor has less than 1 input" << endl;
         return false;
     }
 
     // Create temporary files
-    for (auto i = 0; i < _numOutputs; i++) {
+    for (auto i = 0; i < replica.numOutputs; i++) {
         if (!CreateTmpFile(tmpFile, tmpFd, nullptr, 0)) {
             return false;
         }
         outFiles.push_back(make_pair(tmpFile, tmpFd));
-        if (!larodSetTensorFd(_outputTensors[i], tmpFd, &error)) {
+        if (!larodSetTensorFd(replica.outputTensors[i], tmpFd, &error)) {
             PrintError("Failed to set output tensor file descriptor", error);
             return false;
         }
@@ -951,51 +2367,164 @@ bool Inference::SetupOutputTensors(larodModel*& model,
 // Convert larod response to gRPC message
 // NB! No cleanup is performed here upon failure. The calling function is
 //     expected to handle that.
-bool Inference::LarodOutputToPredictResponse(PredictResponse*& response,
+bool Inference::LarodOutputToPredictResponse(Replica& replica,
+                                             PredictResponse*& response,
                                              const ModelSpec& model_spec,
+                                             const OutputReduction outputReduction,
+                                             const bool floatOutputs,
                                              larodModel*& model,
                                              vector<pair<FILE*, int>>& outFiles,
                                              larodError*& error) {
-    for (auto i = 0; i < _numOutputs; i++) {
-        larodTensor* tensor = _outputTensors[i];
-        TensorProto output;
-        string* tensor_content = output.mutable_tensor_content();
+    // Outputs are built in place in the response, to not copy their content
+    for (auto i = 0; i < replica.numOutputs; i++) {
+        larodTensor* tensor = replica.outputTensors[i];
         auto dataType = larodGetTensorDataType(tensor, &error);
         if (LAROD_TENSOR_DATA_TYPE_INVALID == dataType) {
             PrintError("Failed to get tensor data type", error);
             return false;
         }
-        output.set_dtype(LarodToTfDataType(dataType));
         auto larodTensorDims = larodGetTensorDims(tensor, &error);
         if (nullptr == larodTensorDims) {
             PrintError("Could not get output tensor dimension", error);
             return false;
         }
-        size_t outSize = LarodDataTypeSize(dataType);
-        for (auto j = 0; j < larodTensorDims->len; j++) {
-            outSize *= larodTensorDims->dims[j];
-            auto dim = output.mutable_tensor_shape()->add_dim();
-            dim->set_size(larodTensorDims->dims[j]);
-            dim->set_name("size");
-        }
-        tensor_content->resize(outSize);
-        int fd = outFiles[i].second;
-        if (0 > pread(fd, const_cast<char*>(tensor_content->data()), outSize, 0)) {
-            PrintErrorWithErrno("Failed to read data from output file descriptor");
-            return false;
-        }
         const char* tensorName = larodGetTensorName(tensor, &error);
         if (nullptr == tensorName) {
             PrintError("Could not get name of tensor", error);
             return false;
         }
+        TensorProto& output = (*response->mutable_outputs())[tensorName];
+        string* tensor_content = output.mutable_tensor_content();
+        int fd = outFiles[i].second;
+
+        if (PredictRequest::NONE != outputReduction &&
+            IsSegmentationOutput(dataType, *larodTensorDims)) {
+            if (!ReduceSegmentationOutput(
+                    output, fd, dataType, *larodTensorDims, outputReduction)) {
+                return false;
+            }
+            TRACELOG << "Tensor " << tensorName << " reduced to size "
+                     << tensor_content->size() << endl;
+        } else if (floatOutputs && LAROD_TENSOR_DATA_TYPE_FLOAT16 == dataType) {
+            if (!ReadHalfOutputAsFloat(output, fd, *larodTensorDims)) {
+                return false;
+            }
+            TRACELOG << "Tensor " << tensorName << " converted to size "
+                     << tensor_content->size() << endl;
+        } else {
+            output.set_dtype(LarodToTfDataType(dataType));
+            size_t outSize = LarodDataTypeSize(dataType);
+            for (auto j = 0; j < larodTensorDims->len; j++) {
+                outSize *= larodTensorDims->dims[j];
+                auto dim = output.mutable_tensor_shape()->add_dim();
+                dim->set_size(larodTensorDims->dims[j]);
+                dim->set_name("size");
+            }
+            tensor_content->resize(outSize);
+            if (0 > pread(fd, const_cast<char*>(tensor_content->data()), outSize, 0)) {
+                PrintErrorWithErrno("Failed to read data from output file descriptor");
+                return false;
+            }
+            TRACELOG << "Tensor " << tensorName << " size = " << outSize << endl;
+        }
 
         output.set_version_number(0);
-        TRACELOG << "Tensor " << tensorName << " size = " << outSize << endl;
-        (*response->mutable_outputs())[tensorName] = output;
     }
 
     response->mutable_model_spec()->CopyFrom(model_spec);
     return true;
 }
+
+// Read a half precision output tensor as single precision
+// NB! No cleanup is performed here upon failure. The calling function is
+//     expected to handle that.
+bool Inference::ReadHalfOutputAsFloat(TensorProto& output,
+                                      const int fd,
+                                      const larodTensorDims& dims) {
+    size_t count = 1;
+    for (size_t j = 0; j < dims.len; j++) {
+        count *= dims.dims[j];
+        auto dim = output.mutable_tensor_shape()->add_dim();
+        dim->set_size(dims.dims[j]);
+        dim->set_name("size");
+    }
+    vector<uint16_t> halves(count);
+    if (0 > pread(fd, halves.data(), count * sizeof(uint16_t), 0)) {
+        PrintErrorWithErrno("Failed to read data from output file descriptor");
+        return false;
+    }
+    output.set_dtype(DataType::DT_FLOAT);
+    string* content = output.mutable_tensor_content();
+    content->resize(count * sizeof(float));
+    HalfToFloat(halves.data(), count, reinterpret_cast<float*>(&(*content)[0]));
+    return true;
+}
+
+// Check if an output tensor is a [1, height, width, classes] segmentation map
+bool Inference::IsSegmentationOutput(const larodTensorDataType dataType,
+                                     const larodTensorDims& dims) {
+    if (LAROD_TENSOR_DATA_TYPE_UINT8 != dataType && LAROD_TENSOR_DATA_TYPE_INT8 != dataType &&
+        LAROD_TENSOR_DATA_TYPE_FLOAT32 != dataType) {
+        return false;
+    }
+    return 4 == dims.len && 1 == dims.dims[0] && 1 < dims.dims[3] &&
+           MAX_NBR_CLASSES >= dims.dims[3];
+}
+
+// Replace a segmentation output with its per-pixel class map
+// NB! No cleanup is performed here upon failure. The calling function is
+//     expected to handle that.
+bool Inference::ReduceSegmentationOutput(TensorProto& output,
+                                         const int fd,
+                                         const larodTensorDataType dataType,
+                                         const larodTensorDims& dims,
+                                         const OutputReduction outputReduction) {
+    const size_t height = dims.dims[1];
+    const size_t width = dims.dims[2];
+    const size_t numClasses = dims.dims[3];
+    const size_t numPixels = height * width;
+    const size_t outSize = numPixels * numClasses * LarodDataTypeSize(dataType);
+
+    // Map the model output instead of reading it, since only the class map is kept
+    void* scores = mmap(nullptr, outSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == scores) {
+        PrintErrorWithErrno("Failed to map output file descriptor");
+        return false;
+    }
+
+    string classMap(numPixels, '\0');
+    uint8_t* classes = reinterpret_cast<uint8_t*>(classMap.data());
+    switch (dataType) {
+        case LAROD_TENSOR_DATA_TYPE_UINT8:
+            ArgmaxChannels(static_cast<const uint8_t*>(scores), numPixels, numClasses, classes);
+            break;
+        case LAROD_TENSOR_DATA_TYPE_INT8:
+            ArgmaxChannels(static_cast<const int8_t*>(scores), numPixels, numClasses, classes);
+            break;
+        default:
+            ArgmaxChannels(static_cast<const float*>(scores), numPixels, numClasses, classes);
+            break;
+    }
+    munmap(scores, outSize);
+
+    auto shape = output.mutable_tensor_shape();
+    if (PredictRequest::ARGMAX_RLE == outputReduction) {
+        vector<int32_t> runs;
+        size_t numRuns = RunLengthEncode(classes, numPixels, runs);
+        output.set_dtype(DataType::DT_INT32);
+        shape->add_dim()->set_size(numRuns);
+        shape->add_dim()->set_size(2);
+        output.set_tensor_content(runs.data(), runs.size() * sizeof(int32_t));
+    } else {
+        output.set_dtype(DataType::DT_UINT8);
+        shape->add_dim()->set_size(1);
+        shape->add_dim()->set_size(height);
+        shape->add_dim()->set_size(width);
+        *output.mutable_tensor_content() = std::move(classMap);
+    }
+    for (auto& dim : *shape->mutable_dim()) {
+        dim.set_name("size");
+    }
+    return true;
+}
 }  // namespace acap_runtime
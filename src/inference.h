@@ -14,32 +14,111 @@
  * limitations under the License.
  */
 
+#include "message_arena.h"
+#include "placement.h"
 #include "prediction_service.grpc.pb.h"
+#include "result_cache.h"
+#include "scheduler.h"
+#include "tensor_conversion.h"
 #include "video_capture.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <larod.h>
+#include <list>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 
 namespace acap_runtime {
-class Inference : public tensorflow::serving::PredictionService::Service {
+
+class Metric;
+
+// Tunables of the inference service
+struct InferenceSettings {
+    // Time in ms after which a waiting request is served regardless of
+    // priority, 0 for strict priority
+    unsigned int starvationLimit = 0;
+    // Scheduling weights of clients and models, by client id or model name
+    std::map<std::string, double> weights;
+    // Max number of queued and running requests, 0 for no limit
+    unsigned int maxInFlight = 0;
+    // Max number of queued and running requests per model, by model name
+    std::map<std::string, unsigned int> modelMaxInFlight;
+    // Max number of cached results, 0 to disable the result cache
+    unsigned int cacheEntries = 0;
+    // Time in ms that a result is cached
+    unsigned int cacheTtl = 1000;
+    // Max size in bytes of the cached results, 0 for no limit
+    size_t cacheMemory = 32 * 1024 * 1024;
+    // Additional chips on which all models are loaded as replicas
+    std::vector<uint64_t> replicaChips;
+    // Number of timed inferences when benchmarking a model on every chip, to
+    // place it on the fastest one, 0 to use the given chips
+    unsigned int benchmarkRuns = 0;
+    // File in which placement decisions are saved, empty to not save them
+    std::string placementFile;
+    // Reload models when their files change
+    bool watchModels = false;
+    // Normalization and quantization of single precision inputs, by model name
+    std::map<std::string, InputTransform> inputTransforms;
+};
+
+class Inference : public tensorflow::serving::PredictionService::CallbackService {
   public:
+    using CallbackServerContext = grpc::CallbackServerContext;
+    using GetModelMetadataRequest = tensorflow::serving::GetModelMetadataRequest;
+    using GetModelMetadataResponse = tensorflow::serving::GetModelMetadataResponse;
     using ModelSpec = tensorflow::serving::ModelSpec;
+    using OutputReduction = tensorflow::serving::PredictRequest::OutputReduction;
     using PredictRequest = tensorflow::serving::PredictRequest;
     using PredictResponse = tensorflow::serving::PredictResponse;
-    using ServerContext = grpc::ServerContext;
+    using ServerContextBase = grpc::ServerContextBase;
+    using ServerUnaryReactor = grpc::ServerUnaryReactor;
     using Status = grpc::Status;
+    using TensorInfo = tensorflow::TensorInfo;
+    using TensorLayout = tensorflow::serving::TensorLayoutMap::TensorLayout;
     using TensorProto = tensorflow::TensorProto;
 
     Inference(const bool verbose,
               const uint64_t chipId,
               const std::vector<std::string>& models,
-              Capture* captureService);
+              Capture* captureService,
+              const InferenceSettings& settings = InferenceSettings(),
+              WorkerPool* workers = nullptr);
     ~Inference();
 
-    Status Predict(ServerContext* context,
+    // Callback API, the calls are run on the worker pool
+    ServerUnaryReactor* Predict(CallbackServerContext* context,
+                                const PredictRequest* request,
+                                PredictResponse* response) override;
+    ServerUnaryReactor* GetModelMetadata(CallbackServerContext* context,
+                                         const GetModelMetadataRequest* request,
+                                         GetModelMetadataResponse* response) override;
+
+    Status Predict(ServerContextBase* context,
                    const PredictRequest* request,
-                   PredictResponse* response) override;
+                   PredictResponse* response);
+    // Serve a Predict call without holding a thread while it is queued. Done
+    // is called once with its status, after which the request and response
+    // are no longer used. Blocks in the caller if there is no worker pool.
+    using PredictDoneFunc = std::function<void(const Status& status)>;
+    void Predict(const PredictRequest* request, PredictResponse* response, PredictDoneFunc done);
+    Status GetModelMetadata(ServerContextBase* context,
+                            const GetModelMetadataRequest* request,
+                            GetModelMetadataResponse* response);
+
+    // Load a new version of a model file in place of the loaded one
+    bool ReloadModel(const std::string& modelFile);
+    // Reload all loaded models in the background
+    void ReloadModels();
 
   private:
+    class PredictCall;
+    class PredictReactor;
+
     void PrintError(const char* msg, larodError* error);
     void PrintErrorWithErrno(const char* msg);
     void PrintTensorProtoDebug(const TensorProto& tp);
@@ -47,46 +126,183 @@ class Inference : public tensorflow::serving::PredictionService::Service {
     bool CreateTmpFile(FILE*& file, int& fd, const void* data, const size_t data_size);
     void CloseTmpFile(FILE*& file, const int& fd);
     void CloseTmpFiles(std::vector<std::pair<FILE*, int>>& tmpFiles);
-    bool LoadModel(larodConnection& conn,
+    // A loaded model, deleted when the last request using it is done
+    using ModelHandle = std::shared_ptr<larodModel>;
+
+    // A larod connection on one chip, with its own instance of every model
+    struct Replica {
+        unsigned int index;  // Of the replica in the scheduler
+        larodChip chip;
+        larodConnection* conn = nullptr;
+        std::map<std::string, ModelHandle> models;
+        // Per request state and the loading of models on conn, guarded by mutex
+        std::mutex mutex;
+        larodModel* ppModel;
+        larodMap* ppMap;
+        larodMap* ppCropMap;
+        larodTensor** ppInputTensors;
+        larodTensor** ppOutputTensors;
+        larodTensor** inputTensors;
+        larodTensor** outputTensors;
+        size_t ppNumInputs;
+        size_t ppNumOutputs;
+        size_t numInputs;
+        size_t numOutputs;
+        // Load, guarded by _replicaMutex
+        unsigned int inFlight = 0;
+        std::chrono::steady_clock::duration busyTime{};
+        std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+        // Metrics of the load, see ConnectReplica
+        Metric* inFlightMetric = nullptr;
+        Metric* requestsMetric = nullptr;
+        Metric* busyMsMetric = nullptr;
+        Metric* utilizationMetric = nullptr;
+    };
+
+    std::vector<larodChip> ListChips();
+    bool ConnectReplica(Replica& replica);
+    bool PlaceModel(const std::string& modelFile);
+    bool IsPlaced(const std::string& modelFile);
+    bool LoadOnAllReplicas(const std::string& modelFile,
+                           std::vector<std::pair<Replica*, ModelHandle>>& loaded);
+    bool LoadOnFastestReplica(const std::string& modelFile,
+                              std::vector<std::pair<Replica*, ModelHandle>>& loaded);
+    bool BenchmarkModel(Replica& replica,
+                        larodModel* model,
+                        const unsigned int runs,
+                        double& latency);
+    void WatchModel(const std::string& modelFile);
+    void FileChanged(const int watch, const char* name);
+    void RequestReload(const std::string& modelFile);
+    void ReloadLoop();
+    bool CheckRequest(const PredictRequest* request,
+                      const PredictResponse* response,
+                      Status& status);
+    // Where the result of a request is looked up and inserted in the result
+    // cache, taken once per request before it is run
+    struct CacheKey {
+        std::string key;  // Empty if the result is not cached
+        uint64_t generation = 0;
+    };
+    CacheKey MakeCacheKey(const PredictRequest* request);
+    bool LookupResult(const CacheKey& cacheKey, PredictResponse* response);
+    void GetSchedule(const ServerContextBase* context,
+                     Priority& priority,
+                     std::string& client,
+                     Scheduler::Clock::time_point& deadline);
+    Status RejectedStatus(ServerContextBase* context);
+    Status RunPredict(ServerContextBase* context,
+                      const PredictRequest* request,
+                      PredictResponse* response,
+                      const CacheKey& cacheKey,
+                      const unsigned int replicaIndex);
+    Replica& SelectReplica(const unsigned int index,
+                           const std::string& modelName,
+                           ModelHandle& model);
+    void ReleaseReplica(Replica& replica, const std::chrono::steady_clock::duration executionTime);
+    bool LoadModel(Replica& replica,
                    const char* modelFile,
-                   const larodChip chip,
-                   const larodAccess access);
-    bool SetupPreprocessing(TensorProto tp,
+                   const larodAccess access,
+                   ModelHandle& model);
+    bool CacheModelMetadata(const std::string& modelFile);
+    bool DescribeTensors(larodTensor** tensors,
+                         const size_t numTensors,
+                         const char* prefix,
+                         google::protobuf::Map<std::string, TensorInfo>& infos,
+                         google::protobuf::Map<std::string, TensorLayout>& layouts,
+                         larodError*& error);
+    bool SetupPreprocessing(Replica& replica,
+                            const TensorProto& tp,
                             larodTensor* tensor,
                             std::vector<std::pair<FILE*, int>>& inFiles,
                             const u_int32_t stream,
                             uint32_t& frame_ref,
+                            const bool forcePreprocessing,
+                            const InputTransform* transform,
                             larodError*& error);
-    bool SetupInputTensors(larodModel*& model,
+    bool ConvertFloatInput(const float* values,
+                           const size_t count,
+                           const larodTensorDataType modelType,
+                           const InputTransform* transform,
+                           FILE*& file,
+                           int& fd);
+    bool TransposeInput(larodTensor* tensor,
+                        const size_t pixels,
+                        const size_t channels,
+                        const bool toPlanar,
+                        int& fd,
+                        std::vector<std::pair<FILE*, int>>& inFiles,
+                        larodError*& error);
+    bool SetupInputTensors(Replica& replica,
+                           larodModel*& model,
                            const google::protobuf::Map<std::string, TensorProto>& inputs,
                            std::vector<std::pair<FILE*, int>>& inFiles,
                            const u_int32_t stream,
                            uint32_t& frame_ref,
+                           const bool forcePreprocessing,
+                           const InputTransform* transform,
                            larodError*& error);
-    bool SetupOutputTensors(larodModel*& model,
+    bool SetupOutputTensors(Replica& replica,
+                            larodModel*& model,
                             std::vector<std::pair<FILE*, int>>& outFiles,
                             larodError*& error);
-    bool LarodOutputToPredictResponse(PredictResponse*& response,
+    bool RunInference(Replica& replica,
+                      larodModel*& model,
+                      const std::string& modelName,
+                      larodMap* ppParams,
+                      const ServerContextBase* context,
+                      larodError*& error);
+    bool PredictTiles(Replica& replica,
+                      const PredictRequest* request,
+                      PredictResponse* response,
+                      larodModel*& model,
+                      const std::string& modelName,
+                      std::vector<std::pair<FILE*, int>>& outFiles,
+                      const ServerContextBase* context,
+                      Status& status,
+                      larodError*& error);
+    bool LarodOutputToPredictResponse(Replica& replica,
+                                      PredictResponse*& response,
                                       const ModelSpec& model_spec,
+                                      const OutputReduction outputReduction,
+                                      const bool floatOutputs,
                                       larodModel*& model,
                                       std::vector<std::pair<FILE*, int>>& outFiles,
                                       larodError*& error);
+    std::string ResultCacheKey(const PredictRequest* request,
+                               const std::string& modelName,
+                               const uint32_t frameRef);
+    bool ReadHalfOutputAsFloat(TensorProto& output, const int fd, const larodTensorDims& dims);
+    bool IsSegmentationOutput(const larodTensorDataType dataType, const larodTensorDims& dims);
+    bool ReduceSegmentationOutput(TensorProto& output,
+                                  const int fd,
+                                  const larodTensorDataType dataType,
+                                  const larodTensorDims& dims,
+                                  const OutputReduction outputReduction);
 
     bool _verbose;
-    larodConnection* _conn = nullptr;
-    larodChip _chipId;
-    std::map<std::string, larodModel*> _models;
-    larodModel* _ppModel;
-    larodMap* _ppMap;
-    std::mutex _mutex;
-    larodTensor** _ppInputTensors;
-    larodTensor** _ppOutputTensors;
-    larodTensor** _inputTensors;
-    larodTensor** _outputTensors;
-    size_t _ppNumInputs;
-    size_t _ppNumOutputs;
-    size_t _numInputs;
-    size_t _numOutputs;
+    std::list<Replica> _replicas;
+    std::mutex _replicaMutex;
+    unsigned int _benchmarkRuns;
+    bool _watchModels;
+    std::mutex _placeMutex;
+    Placement _placement;  // Guarded by _placeMutex
+    std::map<std::string, InputTransform> _inputTransforms;
+    // Metadata fields of each loaded model, guarded by _replicaMutex
+    std::map<std::string, google::protobuf::Map<std::string, google::protobuf::Any>> _modelMetadata;
+    Scheduler _scheduler;
+    ResultCache _resultCache;
+    // Predict calls of the callback API are allocated on arenas
+    ArenaAllocator<PredictRequest, PredictResponse> _predictAllocator;
     Capture* _captureService;
+    WorkerPool* _workers;
+    // Reloading of models, see ReloadLoop
+    std::thread _reloadThread;
+    std::atomic<bool> _stopReload{false};
+    std::mutex _reloadMutex;
+    std::set<std::string> _reloadQueue;  // Guarded by _reloadMutex
+    int _wakeFd = -1;
+    int _inotifyFd = -1;
+    std::map<int, std::string> _watchedDirs;  // Guarded by _replicaMutex
 };
 }  // namespace acap_runtime
@@ -0,0 +1,308 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "local_ring.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace acap_runtime {
+
+// Tensor data is aligned for any element type and for vector loads
+const uint64_t LOCAL_DATA_ALIGNMENT = 64;
+
+inline uint64_t AlignUp(const uint64_t value) {
+    return (value + LOCAL_DATA_ALIGNMENT - 1) & ~(LOCAL_DATA_ALIGNMENT - 1);
+}
+
+LocalRing::LocalRing(LocalRingHeader* header,
+                     uint8_t* slots,
+                     uint32_t numSlots,
+                     uint64_t slotSize)
+    : _header(header), _slots(slots), _numSlots(numSlots), _slotSize(slotSize) {}
+
+uint8_t* LocalRing::Claim() {
+    const uint32_t head = _header->head.load(memory_order_relaxed);
+    if (head - _header->tail.load(memory_order_acquire) >= _numSlots) {
+        return nullptr;
+    }
+    return _slots + (head % _numSlots) * _slotSize;
+}
+
+void LocalRing::Publish() {
+    _header->head.store(_header->head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+uint8_t* LocalRing::Peek() {
+    const uint32_t tail = _header->tail.load(memory_order_relaxed);
+    if (tail == _header->head.load(memory_order_acquire)) {
+        return nullptr;
+    }
+    return _slots + (tail % _numSlots) * _slotSize;
+}
+
+void LocalRing::Release() {
+    _header->tail.store(_header->tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+size_t LocalSharedSize(const uint32_t numSlots, const uint64_t slotSize) {
+    return AlignUp(sizeof(LocalShared)) + 2 * numSlots * slotSize;
+}
+
+LocalRing LocalRequestRing(LocalShared* shared) {
+    uint8_t* slots = reinterpret_cast<uint8_t*>(shared) + AlignUp(sizeof(LocalShared));
+    return LocalRing(&shared->requests, slots, shared->numSlots, shared->slotSize);
+}
+
+LocalRing LocalResponseRing(LocalShared* shared) {
+    uint8_t* slots = reinterpret_cast<uint8_t*>(shared) + AlignUp(sizeof(LocalShared)) +
+                     shared->numSlots * shared->slotSize;
+    return LocalRing(&shared->responses, slots, shared->numSlots, shared->slotSize);
+}
+
+uint8_t* AddLocalTensor(uint8_t* slot,
+                        const uint64_t slotSize,
+                        const string& name,
+                        const int32_t dtype,
+                        const vector<int64_t>& dims,
+                        const uint64_t size) {
+    LocalMessage* message = reinterpret_cast<LocalMessage*>(slot);
+    if (LOCAL_MAX_TENSORS <= message->numTensors || LOCAL_MAX_DIMS < dims.size() ||
+        LOCAL_MAX_NAME <= name.size()) {
+        return nullptr;
+    }
+
+    // Data is placed after the data of the previous tensor
+    uint64_t offset = AlignUp(sizeof(LocalMessage));
+    if (0 < message->numTensors) {
+        const LocalTensor& last = message->tensors[message->numTensors - 1];
+        offset = AlignUp(last.offset + last.size);
+    }
+    if (offset > slotSize || size > slotSize - offset) {
+        return nullptr;
+    }
+
+    LocalTensor& tensor = message->tensors[message->numTensors++];
+    strncpy(tensor.name, name.c_str(), LOCAL_MAX_NAME);
+    tensor.dtype = dtype;
+    tensor.numDims = dims.size();
+    copy(dims.begin(), dims.end(), tensor.dims);
+    tensor.offset = offset;
+    tensor.size = size;
+    return slot + offset;
+}
+
+bool IsValidLocalMessage(const LocalMessage& message, const uint64_t slotSize) {
+    if (LOCAL_FRAME < message.kind || LOCAL_MAX_TENSORS < message.numTensors ||
+        nullptr == memchr(message.model, '\0', LOCAL_MAX_NAME)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < message.numTensors; i++) {
+        const LocalTensor& tensor = message.tensors[i];
+        if (LOCAL_MAX_DIMS < tensor.numDims ||
+            nullptr == memchr(tensor.name, '\0', LOCAL_MAX_NAME) ||
+            tensor.offset < sizeof(LocalMessage) || tensor.offset > slotSize ||
+            tensor.size > slotSize - tensor.offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SendFds(const int socket, const int* fds, const size_t numFds) {
+    char byte = 0;
+    iovec iov = {&byte, 1};
+    vector<char> control(CMSG_SPACE(numFds * sizeof(int)));
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(numFds * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, numFds * sizeof(int));
+    return 1 == sendmsg(socket, &msg, MSG_NOSIGNAL);
+}
+
+bool ReceiveFds(const int socket, int* fds, const size_t numFds) {
+    char byte;
+    iovec iov = {&byte, 1};
+    vector<char> control(CMSG_SPACE(numFds * sizeof(int)));
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    if (1 != recvmsg(socket, &msg, MSG_CMSG_CLOEXEC)) {
+        return false;
+    }
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (nullptr == cmsg || SCM_RIGHTS != cmsg->cmsg_type ||
+        CMSG_LEN(numFds * sizeof(int)) != cmsg->cmsg_len) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), numFds * sizeof(int));
+    return true;
+}
+
+LocalRingClient::~LocalRingClient() {
+    if (nullptr != _shared) {
+        munmap(_shared, _size);
+    }
+    for (int fd : {_socket, _memFd, _requestEvent, _responseEvent}) {
+        if (0 <= fd) {
+            close(fd);
+        }
+    }
+}
+
+bool LocalRingClient::Connect(const string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (sizeof(address.sun_path) <= socketPath.size()) {
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+    _socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (0 > _socket ||
+        0 != connect(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address))) {
+        return false;
+    }
+
+    int fds[3];
+    struct stat info;
+    if (!ReceiveFds(_socket, fds, 3)) {
+        return false;
+    }
+    _memFd = fds[0];
+    _requestEvent = fds[1];
+    _responseEvent = fds[2];
+    if (0 != fstat(_memFd, &info)) {
+        return false;
+    }
+    _size = info.st_size;
+    void* shared = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _memFd, 0);
+    if (MAP_FAILED == shared) {
+        return false;
+    }
+    _shared = static_cast<LocalShared*>(shared);
+    if (LOCAL_RING_MAGIC != _shared->magic ||
+        LocalSharedSize(_shared->numSlots, _shared->slotSize) > _size) {
+        return false;
+    }
+    _requests = LocalRequestRing(_shared);
+    _responses = LocalResponseRing(_shared);
+    return true;
+}
+
+LocalMessage* LocalRingClient::BeginRequest(const uint64_t id, const string& model) {
+    _request = _requests.Claim();
+    if (nullptr == _request || LOCAL_MAX_NAME <= model.size()) {
+        _request = nullptr;
+        return nullptr;
+    }
+    LocalMessage* message = reinterpret_cast<LocalMessage*>(_request);
+    memset(message, 0, sizeof(LocalMessage));
+    message->id = id;
+    strcpy(message->model, model.c_str());
+    return message;
+}
+
+uint8_t* LocalRingClient::AddInput(const string& name,
+                                   const int32_t dtype,
+                                   const vector<int64_t>& dims,
+                                   const uint64_t size) {
+    if (nullptr == _request) {
+        return nullptr;
+    }
+    return AddLocalTensor(_request, _requests.SlotSize(), name, dtype, dims, size);
+}
+
+LocalMessage* LocalRingClient::BeginFrameRequest(const uint64_t id,
+                                                 const uint32_t streamId,
+                                                 const uint32_t frameReference) {
+    LocalMessage* message = BeginRequest(id, "");
+    if (nullptr != message) {
+        message->kind = LOCAL_FRAME;
+        message->frame.streamId = streamId;
+        message->frame.frameReference = frameReference;
+    }
+    return message;
+}
+
+bool LocalRingClient::PostRequest() {
+    if (nullptr == _request) {
+        return false;
+    }
+    _request = nullptr;
+    _requests.Publish();
+    const uint64_t one = 1;
+    return sizeof(one) == write(_requestEvent, &one, sizeof(one));
+}
+
+const LocalMessage* LocalRingClient::WaitResponse(const int timeoutMs) {
+    // The event may be left from responses that were already read, so it is
+    // cleared and the ring checked again until the deadline
+    const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    uint8_t* slot;
+    while (nullptr == (slot = _responses.Peek())) {
+        const auto left =
+            chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+        pollfd event = {_responseEvent, POLLIN, 0};
+        if (0 > left.count() || 0 >= poll(&event, 1, left.count())) {
+            return nullptr;
+        }
+        uint64_t count;
+        if (0 > read(_responseEvent, &count, sizeof(count)) && EAGAIN != errno) {
+            return nullptr;
+        }
+    }
+    return reinterpret_cast<const LocalMessage*>(slot);
+}
+
+const uint8_t* LocalRingClient::TensorData(const LocalMessage* message,
+                                           const LocalTensor& tensor) const {
+    return reinterpret_cast<const uint8_t*>(message) + tensor.offset;
+}
+
+bool LocalRingClient::ReleaseResponse() {
+    _responses.Release();
+
+    // Ordered after the release, as the service sets the flag before it
+    // checks for a free slot
+    atomic_thread_fence(memory_order_seq_cst);
+    if (0 == _shared->releaseWanted.load(memory_order_relaxed)) {
+        return true;
+    }
+    const uint64_t one = 1;
+    return sizeof(one) == write(_requestEvent, &one, sizeof(one));
+}
+
+int LocalRingClient::ReceiveFrame() {
+    int fd;
+    return ReceiveFds(_socket, &fd, 1) ? fd : -1;
+}
+}  // namespace acap_runtime
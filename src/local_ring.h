@@ -0,0 +1,200 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOCAL_RING_H
+#define LOCAL_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace acap_runtime {
+
+const uint32_t LOCAL_RING_MAGIC = 0x61727233;  // "arr3"
+const size_t LOCAL_MAX_TENSORS = 8;
+const size_t LOCAL_MAX_DIMS = 8;
+const size_t LOCAL_MAX_NAME = 128;
+
+// A tensor of a message, with its data at offset from the start of the slot
+struct LocalTensor {
+    char name[LOCAL_MAX_NAME];
+    int32_t dtype;  // tensorflow::DataType
+    uint32_t numDims;
+    int64_t dims[LOCAL_MAX_DIMS];
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Kind of a message, a response has the kind of its request
+enum LocalKind : uint32_t {
+    LOCAL_PREDICT = 0,
+    LOCAL_FRAME = 1,
+};
+
+// A frame of a video capture stream. The request has the stream and an
+// optional saved frame, the response the rest. The file descriptor of the
+// frame is sent over the socket of the connection before the response.
+struct LocalFrame {
+    uint32_t streamId;
+    uint32_t frameReference;  // 0 to capture a new frame
+    uint64_t offset;          // Of the frame in its file descriptor
+    uint64_t size;
+    uint64_t timestamp;
+    uint64_t customTimestamp;
+    uint32_t sequenceNbr;
+    char type[16];
+};
+
+// A request or response, at the start of a slot
+struct LocalMessage {
+    uint64_t id;      // Chosen by the client and returned in the response
+    int32_t status;   // grpc::StatusCode of a response
+    uint32_t kind;    // LocalKind
+    uint32_t numTensors;
+    char model[LOCAL_MAX_NAME];
+    LocalFrame frame;
+    LocalTensor tensors[LOCAL_MAX_TENSORS];
+};
+
+// Indices of a single producer, single consumer ring. They only grow, and are
+// on separate cache lines so that the two sides do not share one.
+struct LocalRingHeader {
+    alignas(64) std::atomic<uint32_t> head;  // Written by the producer
+    alignas(64) std::atomic<uint32_t> tail;  // Written by the consumer
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Ring indices must be lock free");
+
+// Start of the shared memory of a connection, followed by the request slots
+// and then the response slots
+struct LocalShared {
+    uint32_t magic;
+    uint32_t numSlots;
+    uint64_t slotSize;
+    LocalRingHeader requests;
+    LocalRingHeader responses;
+    // Set by the service while responses wait for a free slot, so that the
+    // client signals the request event when it releases one
+    alignas(64) std::atomic<uint32_t> releaseWanted;
+};
+
+/**
+ * @brief View of a ring of fixed size slots in shared memory
+ *
+ * Requests are produced by the client and consumed by the service, and
+ * responses the other way around. Each side only writes its own index.
+ */
+class LocalRing {
+  public:
+    LocalRing() = default;
+    LocalRing(LocalRingHeader* header, uint8_t* slots, uint32_t numSlots, uint64_t slotSize);
+
+    // Next free slot of the producer, or nullptr if the ring is full
+    uint8_t* Claim();
+    // Make the claimed slot visible to the consumer
+    void Publish();
+    // Oldest published slot of the consumer, or nullptr if the ring is empty
+    uint8_t* Peek();
+    // Give the oldest slot back to the producer
+    void Release();
+
+    uint64_t SlotSize() const { return _slotSize; }
+
+  private:
+    LocalRingHeader* _header = nullptr;
+    uint8_t* _slots = nullptr;
+    uint32_t _numSlots = 0;
+    uint64_t _slotSize = 0;
+};
+
+// Size of the shared memory of a connection
+size_t LocalSharedSize(const uint32_t numSlots, const uint64_t slotSize);
+LocalRing LocalRequestRing(LocalShared* shared);
+LocalRing LocalResponseRing(LocalShared* shared);
+
+// Add a tensor to the message at the start of a slot, returns where its data
+// is to be written or nullptr if it does not fit
+uint8_t* AddLocalTensor(uint8_t* slot,
+                        const uint64_t slotSize,
+                        const std::string& name,
+                        const int32_t dtype,
+                        const std::vector<int64_t>& dims,
+                        const uint64_t size);
+// Check that the tensors of a message are within its slot
+bool IsValidLocalMessage(const LocalMessage& message, const uint64_t slotSize);
+
+// Pass file descriptors over a unix socket
+bool SendFds(const int socket, const int* fds, const size_t numFds);
+bool ReceiveFds(const int socket, int* fds, const size_t numFds);
+
+/**
+ * @brief Client side of a local transport connection
+ *
+ * The shared memory and event file descriptors are received over the unix
+ * socket of the service. Requests are written directly in the request ring,
+ * at most one at a time per slot, and responses are read in place.
+ */
+class LocalRingClient {
+  public:
+    ~LocalRingClient();
+
+    bool Connect(const std::string& socketPath);
+
+    // Start a request in the next free slot, nullptr if all slots are in use
+    LocalMessage* BeginRequest(const uint64_t id, const std::string& model);
+    // Add an input to the request, returns where to write its data
+    uint8_t* AddInput(const std::string& name,
+                      const int32_t dtype,
+                      const std::vector<int64_t>& dims,
+                      const uint64_t size);
+    // Start a request for a frame, nullptr if all slots are in use
+    LocalMessage* BeginFrameRequest(const uint64_t id,
+                                    const uint32_t streamId,
+                                    const uint32_t frameReference = 0);
+    // Send the started request to the service
+    bool PostRequest();
+
+    // Wait for the next response, nullptr on timeout
+    const LocalMessage* WaitResponse(const int timeoutMs);
+    const uint8_t* TensorData(const LocalMessage* message, const LocalTensor& tensor) const;
+    // Give the slot of the latest response back to the service, which is
+    // signalled if it has responses waiting for a slot
+    bool ReleaseResponse();
+    // File descriptor of a frame response with status OK, to be closed by the
+    // caller. Must be called once for each such response, in order.
+    //
+    // The descriptor stays open after the frame is evicted, but the frame is
+    // only valid while it is saved: once later frames of the stream evict it,
+    // VDO may reuse the buffer for new frames. A stream saving N frames keeps
+    // a frame valid until N more frames of the stream are taken, so frames
+    // are only exported from streams that save at least two.
+    int ReceiveFrame();
+
+  private:
+    int _socket = -1;
+    int _memFd = -1;
+    int _requestEvent = -1;
+    int _responseEvent = -1;
+    LocalShared* _shared = nullptr;
+    size_t _size = 0;
+    LocalRing _requests;
+    LocalRing _responses;
+    uint8_t* _request = nullptr;
+};
+}  // namespace acap_runtime
+
+#endif
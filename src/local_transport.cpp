@@ -0,0 +1,470 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "local_transport.h"
+#include "metrics.h"
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#define ERRORLOG std::cerr << "ERROR in LocalTransport: "
+#define TRACELOG  \
+    if (_verbose) \
+    std::cout << "TRACE in LocalTransport: "
+
+using namespace grpc;
+using namespace std;
+
+namespace acap_runtime {
+
+static Metric& connectionsMetric = Metrics::Register("local.connections");
+static Metric& requestsMetric = Metrics::Register("local.requests");
+static Metric& framesMetric = Metrics::Register("local.frames");
+
+LocalTransport::LocalTransport(const bool verbose,
+                               const string& socketPath,
+                               const uint32_t numSlots,
+                               const uint64_t slotSize,
+                               Handler handler,
+                               FrameHandler frameHandler,
+                               WorkerPool* workers)
+    : _verbose(verbose), _socketPath(socketPath), _numSlots(numSlots), _slotSize(slotSize),
+      _handler(move(handler)), _frameHandler(move(frameHandler)), _workers(workers) {
+    TRACELOG << "Init " << socketPath << " with " << numSlots << " slots of " << slotSize
+             << " bytes" << endl;
+    if (0 == numSlots || sizeof(LocalMessage) >= slotSize) {
+        ERRORLOG << "Slots are too small" << endl;
+        throw runtime_error("Could not Init Local Transport");
+    }
+    _wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (0 > _wakeFd) {
+        PrintErrorWithErrno("Failed to create stop event");
+        throw runtime_error("Could not Init Local Transport");
+    }
+    if (!Listen()) {
+        close(_wakeFd);
+        throw runtime_error("Could not Init Local Transport");
+    }
+    _thread = thread(&LocalTransport::Loop, this);
+}
+
+// Requests that are being served are finished before the connections are
+// closed, since their handler may refer to the services
+LocalTransport::~LocalTransport() {
+    _stopping = true;
+    const uint64_t wake = 1;
+    if (0 > write(_wakeFd, &wake, sizeof(wake))) {
+        PrintErrorWithErrno("Failed to stop local transport");
+    }
+    _thread.join();
+    for (auto& [socket, connection] : _connections) {
+        connection->closed = true;
+    }
+    {
+        unique_lock lock(_mutex);
+        _idle.wait(lock, [this] { return 0 == _inFlight; });
+    }
+    _connections.clear();
+    close(_listenFd);
+    close(_wakeFd);
+    unlink(_socketPath.c_str());
+}
+
+LocalTransport::Connection::~Connection() {
+    for (PendingResponse& response : pending) {
+        if (0 <= response.fd) {
+            close(response.fd);
+        }
+    }
+    if (nullptr != shared) {
+        munmap(shared, size);
+    }
+    for (int fd : {socket, memFd, requestEvent, responseEvent}) {
+        if (0 <= fd) {
+            close(fd);
+        }
+    }
+}
+
+bool LocalTransport::Listen() {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (sizeof(address.sun_path) <= _socketPath.size()) {
+        ERRORLOG << "Socket path is too long: " << _socketPath << endl;
+        return false;
+    }
+    strcpy(address.sun_path, _socketPath.c_str());
+
+    // A socket left by a previous run is replaced
+    unlink(_socketPath.c_str());
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (0 > _listenFd) {
+        PrintErrorWithErrno("Failed to create socket");
+        return false;
+    }
+    if (0 != bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ||
+        0 != listen(_listenFd, SOMAXCONN)) {
+        PrintErrorWithErrno("Failed to listen on socket");
+        close(_listenFd);
+        return false;
+    }
+    return true;
+}
+
+void LocalTransport::Loop() {
+    vector<pollfd> fds;
+    while (!_stopping) {
+        fds.assign({{_wakeFd, POLLIN, 0}, {_listenFd, POLLIN, 0}});
+        for (auto& [socket, connection] : _connections) {
+            fds.push_back({socket, POLLIN, 0});
+            fds.push_back({connection->requestEvent, POLLIN, 0});
+        }
+        if (0 > poll(fds.data(), fds.size(), -1)) {
+            if (EINTR != errno) {
+                PrintErrorWithErrno("Failed to poll local transport");
+                return;
+            }
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            Accept();
+        }
+        for (size_t i = 2; i < fds.size(); i += 2) {
+            auto connection = _connections.at(fds[i].fd);
+            if (fds[i + 1].revents & POLLIN) {
+                ServeRequests(connection);
+            }
+
+            // Clients never write to the socket, so it is readable when closed
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                TRACELOG << "Client disconnected" << endl;
+                connection->closed = true;
+                _connections.erase(fds[i].fd);
+                connectionsMetric.Set(_connections.size());
+            }
+        }
+    }
+}
+
+void LocalTransport::Accept() {
+    auto connection = make_shared<Connection>();
+    connection->socket = accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (0 > connection->socket) {
+        PrintErrorWithErrno("Failed to accept client");
+        return;
+    }
+
+    // memfd_create does not work inside containers
+    connection->size = LocalSharedSize(_numSlots, _slotSize);
+#ifdef USE_MEMFD_CREATE
+    connection->memFd = memfd_create("acap-runtime-local", MFD_CLOEXEC);
+#else
+    const string name =
+        "/acap-runtime-local-" + to_string(getpid()) + "-" + to_string(connection->socket);
+    connection->memFd =
+        shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    shm_unlink(name.c_str());
+#endif
+    if (0 > connection->memFd || 0 != ftruncate(connection->memFd, connection->size)) {
+        PrintErrorWithErrno("Failed to create shared memory");
+        return;
+    }
+    void* shared = mmap(nullptr,
+                        connection->size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED,
+                        connection->memFd,
+                        0);
+    if (MAP_FAILED == shared) {
+        PrintErrorWithErrno("Failed to map shared memory");
+        return;
+    }
+    connection->shared = new (shared) LocalShared{};
+    connection->shared->magic = LOCAL_RING_MAGIC;
+    connection->shared->numSlots = _numSlots;
+    connection->shared->slotSize = _slotSize;
+    connection->requests = LocalRequestRing(connection->shared);
+    connection->responses = LocalResponseRing(connection->shared);
+
+    connection->requestEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    connection->responseEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    const int fds[] = {connection->memFd, connection->requestEvent, connection->responseEvent};
+    if (0 > connection->requestEvent || 0 > connection->responseEvent ||
+        !SendFds(connection->socket, fds, 3)) {
+        PrintErrorWithErrno("Failed to hand over shared memory");
+        return;
+    }
+
+    TRACELOG << "Client connected" << endl;
+    _connections[connection->socket] = connection;
+    connectionsMetric.Set(_connections.size());
+}
+
+// Requests are copied out of their slot, which is released before the request
+// is served so that the client can post the next one. The client can write the
+// slot at any time, so its header is copied before it is validated and only
+// the copy is used. The request event is also signalled by the client when it
+// releases a response slot that responses wait for, and by the service when
+// requests left in the ring can be taken.
+void LocalTransport::ServeRequests(const shared_ptr<Connection>& connection) {
+    uint64_t count;
+    if (0 > read(connection->requestEvent, &count, sizeof(count)) && EAGAIN != errno) {
+        PrintErrorWithErrno("Failed to read request event");
+    }
+
+    {
+        scoped_lock lock(connection->responseMutex);
+        FlushResponses(*connection);
+    }
+
+    uint8_t* slot;
+    LocalMessage message;
+    while (nullptr != (slot = connection->requests.Peek())) {
+        // Leave requests in the ring while every response slot has a request
+        // in service, until a response is written
+        if (_numSlots <= connection->unanswered) {
+            connection->throttled = true;
+            if (_numSlots <= connection->unanswered) {
+                break;
+            }
+            connection->throttled = false;
+        }
+        connection->unanswered++;
+
+        memcpy(&message, slot, sizeof(message));
+        const uint64_t id = message.id;
+        if (!IsValidLocalMessage(message, _slotSize)) {
+            connection->requests.Release();
+            Respond(*connection, id, Status(StatusCode::INVALID_ARGUMENT, "Invalid request"),
+                    nullptr);
+            continue;
+        }
+
+        if (LOCAL_FRAME == message.kind) {
+            GetFrameRequest request;
+            request.set_stream_id(message.frame.streamId);
+            request.set_frame_reference(message.frame.frameReference);
+            connection->requests.Release();
+            framesMetric.Add();
+            Run([this, connection, id, request]() { ServeFrame(*connection, id, request); });
+            continue;
+        }
+
+        auto request = make_shared<PredictRequest>();
+        request->mutable_model_spec()->set_name(message.model);
+        auto& inputs = *request->mutable_inputs();
+        for (uint32_t i = 0; i < message.numTensors; i++) {
+            const LocalTensor& tensor = message.tensors[i];
+            auto& tp = inputs[tensor.name];
+            tp.set_dtype(static_cast<tensorflow::DataType>(tensor.dtype));
+            for (uint32_t d = 0; d < tensor.numDims; d++) {
+                tp.mutable_tensor_shape()->add_dim()->set_size(tensor.dims[d]);
+            }
+            tp.set_tensor_content(slot + tensor.offset, tensor.size);
+        }
+        connection->requests.Release();
+        requestsMetric.Add();
+        auto response = make_shared<PredictResponse>();
+        Begin();
+        _handler(request.get(),
+                 response.get(),
+                 [this, connection, id, request, response](const Status& status) {
+                     Respond(*connection, id, status, response);
+                     End();
+                 });
+    }
+}
+
+// Run a frame request on the worker pool, or on the loop thread if there is none
+void LocalTransport::Run(function<void()> serve) {
+    if (nullptr == _workers) {
+        serve();
+        return;
+    }
+
+    Begin();
+    _workers->Run([this, serve]() {
+        serve();
+        End();
+    });
+}
+
+// Count a request as being served, until End
+void LocalTransport::Begin() {
+    scoped_lock lock(_mutex);
+    _inFlight++;
+}
+
+void LocalTransport::End() {
+    scoped_lock lock(_mutex);
+    if (0 == --_inFlight) {
+        _idle.notify_all();
+    }
+}
+
+void LocalTransport::ServeFrame(Connection& connection,
+                                const uint64_t id,
+                                const GetFrameRequest& request) {
+    GetFrameResponse response;
+    int fd = -1;
+    Status status = _frameHandler ? _frameHandler(&request, &response, &fd)
+                                  : Status(StatusCode::UNIMPLEMENTED, "Frames are not exported");
+    RespondFrame(connection, id, status, response, fd);
+}
+
+// Queue a response and write it if the client has a free slot, otherwise it
+// waits for the client to release one. Responses of a connection are written in
+// the order they are queued.
+void LocalTransport::Send(Connection& connection, PendingResponse response) {
+    scoped_lock lock(connection.responseMutex);
+    if (connection.closed) {
+        if (0 <= response.fd) {
+            close(response.fd);
+        }
+        return;
+    }
+    connection.pending.push_back(move(response));
+    FlushResponses(connection);
+}
+
+// Write queued responses while the client has free slots. When it has none,
+// the client is asked to signal the request event when it releases one.
+// NB! Called with responseMutex held
+void LocalTransport::FlushResponses(Connection& connection) {
+    while (!connection.pending.empty()) {
+        uint8_t* slot = connection.responses.Claim();
+        if (nullptr == slot) {
+            connection.shared->releaseWanted.store(1, memory_order_relaxed);
+            // Ordered before the check for a slot released meanwhile, as the
+            // client releases its slot before it checks the flag
+            atomic_thread_fence(memory_order_seq_cst);
+            if (nullptr == (slot = connection.responses.Claim())) {
+                return;
+            }
+        }
+
+        PendingResponse& response = connection.pending.front();
+        LocalMessage* message = reinterpret_cast<LocalMessage*>(slot);
+        memset(message, 0, sizeof(LocalMessage));
+        message->id = response.id;
+        message->kind = response.kind;
+        response.write(message);
+        // The file descriptor is sent while the slot is claimed, so that file
+        // descriptors are received in the order of the responses
+        if (0 <= response.fd) {
+            if (!SendFds(connection.socket, &response.fd, 1)) {
+                PrintErrorWithErrno("Failed to send frame");
+                message->status = StatusCode::UNAVAILABLE;
+            }
+            close(response.fd);
+        }
+        connection.pending.pop_front();
+        PublishResponse(connection);
+    }
+
+    if (0 != connection.shared->releaseWanted.load(memory_order_relaxed)) {
+        connection.shared->releaseWanted.store(0, memory_order_relaxed);
+    }
+}
+
+// NB! Called with responseMutex held
+void LocalTransport::PublishResponse(Connection& connection) {
+    connection.responses.Publish();
+
+    const uint64_t one = 1;
+    if (0 > write(connection.responseEvent, &one, sizeof(one))) {
+        PrintErrorWithErrno("Failed to signal response");
+    }
+
+    // Take the requests left in the ring, now that a response slot is answered
+    connection.unanswered--;
+    if (connection.throttled.exchange(false) &&
+        0 > write(connection.requestEvent, &one, sizeof(one))) {
+        PrintErrorWithErrno("Failed to resume requests");
+    }
+}
+
+void LocalTransport::Respond(Connection& connection,
+                             const uint64_t id,
+                             const Status& status,
+                             shared_ptr<const PredictResponse> response) {
+    const StatusCode code = status.error_code();
+    auto write = [this, code, response](LocalMessage* message) {
+        uint8_t* slot = reinterpret_cast<uint8_t*>(message);
+        message->status = code;
+        if (StatusCode::OK != code || nullptr == response) {
+            return;
+        }
+        for (auto& [name, tp] : response->outputs()) {
+            vector<int64_t> dims;
+            for (auto& dim : tp.tensor_shape().dim()) {
+                dims.push_back(dim.size());
+            }
+            const string& content = tp.tensor_content();
+            uint8_t* data = AddLocalTensor(slot, _slotSize, name, tp.dtype(), dims, content.size());
+            if (nullptr == data) {
+                ERRORLOG << "Output " << name << " does not fit in a slot" << endl;
+                message->status = StatusCode::RESOURCE_EXHAUSTED;
+                message->numTensors = 0;
+                return;
+            }
+            memcpy(data, content.data(), content.size());
+        }
+    };
+    Send(connection, PendingResponse{id, LOCAL_PREDICT, write});
+}
+
+void LocalTransport::RespondFrame(Connection& connection,
+                                  const uint64_t id,
+                                  const Status& status,
+                                  const GetFrameResponse& response,
+                                  const int fd) {
+    const StatusCode code = status.error_code();
+    auto write = [code, response](LocalMessage* message) {
+        message->status = code;
+        if (StatusCode::OK != code) {
+            return;
+        }
+        LocalFrame& frame = message->frame;
+        frame.frameReference = response.frame_reference();
+        frame.offset = response.offset();
+        frame.size = response.size();
+        frame.timestamp = response.timestamp();
+        frame.customTimestamp = response.custom_timestamp();
+        frame.sequenceNbr = response.sequence_nbr();
+        strncpy(frame.type, response.type().c_str(), sizeof(frame.type) - 1);
+    };
+
+    // No file descriptor is sent with an error
+    if (!status.ok() && 0 <= fd) {
+        close(fd);
+    }
+    Send(connection, PendingResponse{id, LOCAL_FRAME, write, status.ok() ? fd : -1});
+}
+
+// Print formatted error message with error number
+void LocalTransport::PrintErrorWithErrno(const char* msg) {
+    ERRORLOG << msg << " (" << strerror(errno) << ")" << endl;
+}
+}  // namespace acap_runtime
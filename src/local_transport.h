@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOCAL_TRANSPORT_H
+#define LOCAL_TRANSPORT_H
+
+#include "local_ring.h"
+#include "prediction_service.grpc.pb.h"
+#include "videocapture.grpc.pb.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace acap_runtime {
+
+/**
+ * @brief Predict requests of co-located clients through shared memory
+ *
+ * A client connects to a unix socket and receives a memory file with a ring
+ * of requests and a ring of responses, and an event for each direction. The
+ * tensors are written and read in place by the client, so the calls skip
+ * HTTP/2 and protobuf encoding. Predict requests are handed to the handler,
+ * which schedules them without holding a thread, and frame requests are
+ * served on the worker pool.
+ *
+ * A response that finds no free slot waits in a queue of its connection until
+ * the client releases one, so no thread waits for a client. A connection has
+ * at most as many requests in service as it has response slots.
+ *
+ * Frames are exported by file descriptor over the socket, so that the pixel
+ * data is never copied.
+ */
+class LocalTransport {
+  public:
+    using PredictRequest = tensorflow::serving::PredictRequest;
+    using PredictResponse = tensorflow::serving::PredictResponse;
+    // Serves a request without blocking and calls done with its status, after
+    // which the request and response are no longer used
+    using DoneFunc = std::function<void(const grpc::Status& status)>;
+    using Handler = std::function<void(const PredictRequest*, PredictResponse*, DoneFunc done)>;
+    using GetFrameRequest = videocapture::v1::GetFrameRequest;
+    using GetFrameResponse = videocapture::v1::GetFrameResponse;
+    // Exports a frame by a file descriptor, which is closed once it is sent
+    using FrameHandler =
+        std::function<grpc::Status(const GetFrameRequest*, GetFrameResponse*, int*)>;
+
+    LocalTransport(const bool verbose,
+                   const std::string& socketPath,
+                   const uint32_t numSlots,
+                   const uint64_t slotSize,
+                   Handler handler,
+                   FrameHandler frameHandler = nullptr,
+                   WorkerPool* workers = nullptr);
+    ~LocalTransport();
+
+  private:
+    // A response waiting for a free slot, which is written by write. A file
+    // descriptor is sent over the socket when the slot is written, then closed.
+    struct PendingResponse {
+        uint64_t id;
+        uint32_t kind;
+        std::function<void(LocalMessage* message)> write;
+        int fd = -1;
+    };
+
+    struct Connection {
+        ~Connection();
+
+        int socket = -1;
+        int memFd = -1;
+        int requestEvent = -1;
+        int responseEvent = -1;
+        LocalShared* shared = nullptr;
+        size_t size = 0;
+        LocalRing requests;                   // Consumed by the loop thread only
+        LocalRing responses;                  // Guarded by responseMutex
+        std::deque<PendingResponse> pending;  // Guarded by responseMutex
+        std::mutex responseMutex;
+        // Requests taken from the ring whose responses are not yet in a slot
+        std::atomic<uint32_t> unanswered{0};
+        // Set when requests are left in the ring until a response is written
+        std::atomic<bool> throttled{false};
+        std::atomic<bool> closed{false};
+    };
+
+    bool Listen();
+    void Loop();
+    void Accept();
+    void ServeRequests(const std::shared_ptr<Connection>& connection);
+    void Run(std::function<void()> serve);
+    void Begin();
+    void End();
+    void ServeFrame(Connection& connection, const uint64_t id, const GetFrameRequest& request);
+    void Respond(Connection& connection,
+                 const uint64_t id,
+                 const grpc::Status& status,
+                 std::shared_ptr<const PredictResponse> response);
+    // Respond with a frame, the file descriptor is closed once it is sent
+    void RespondFrame(Connection& connection,
+                      const uint64_t id,
+                      const grpc::Status& status,
+                      const GetFrameResponse& response,
+                      const int fd);
+    void Send(Connection& connection, PendingResponse response);
+    void FlushResponses(Connection& connection);
+    void PublishResponse(Connection& connection);
+    void PrintErrorWithErrno(const char* msg);
+
+    bool _verbose;
+    std::string _socketPath;
+    uint32_t _numSlots;
+    uint64_t _slotSize;
+    Handler _handler;
+    FrameHandler _frameHandler;
+    WorkerPool* _workers;
+    int _listenFd = -1;
+    int _wakeFd = -1;
+    std::map<int, std::shared_ptr<Connection>> _connections;  // By socket
+    std::thread _thread;
+    std::atomic<bool> _stopping{false};
+    unsigned int _inFlight = 0;  // Guarded by _mutex
+    std::mutex _mutex;
+    std::condition_variable _idle;
+};
+}  // namespace acap_runtime
+
+#endif
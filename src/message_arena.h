@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MESSAGE_ARENA_H
+#define MESSAGE_ARENA_H
+
+#include <google/protobuf/arena.h>
+#include <grpcpp/support/message_allocator.h>
+
+namespace acap_runtime {
+
+// Size of the first block of an arena, which holds a request with its small
+// tensors without further allocations
+const size_t ARENA_START_BLOCK_SIZE = 4096;
+
+/**
+ * @brief Allocates the messages of callback API calls on protobuf arenas
+ *
+ * The request and the response of a call, with all their tensors, are created
+ * on an arena of the call and freed at once when the call is done. Only the
+ * content of bytes fields, such as tensor_content, is allocated on its own.
+ */
+template <typename Request, typename Response>
+class ArenaAllocator : public grpc::MessageAllocator<Request, Response> {
+  public:
+    grpc::MessageHolder<Request, Response>* AllocateMessages() override {
+        return new Holder();
+    }
+
+  private:
+    class Holder : public grpc::MessageHolder<Request, Response> {
+      public:
+        Holder() : _arena(Options()) {
+            this->set_request(google::protobuf::Arena::CreateMessage<Request>(&_arena));
+            this->set_response(google::protobuf::Arena::CreateMessage<Response>(&_arena));
+        }
+
+        void Release() override { delete this; }
+
+      private:
+        static google::protobuf::ArenaOptions Options() {
+            google::protobuf::ArenaOptions options;
+            options.start_block_size = ARENA_START_BLOCK_SIZE;
+            return options;
+        }
+
+        google::protobuf::Arena _arena;
+    };
+};
+}  // namespace acap_runtime
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics.h"
+
+using namespace grpc;
+using namespace std;
+
+#define TRACELOG  \
+    if (_verbose) \
+    cout << "TRACE in Metrics: "
+
+namespace acap_runtime {
+
+Metrics::Metrics(bool verbose) : _verbose(verbose) {
+    TRACELOG << "Init" << endl;
+}
+
+// Get all metrics matching a name prefix
+ServerUnaryReactor* Metrics::GetMetrics(CallbackServerContext* context,
+                                        const GetMetricsRequest* request,
+                                        GetMetricsResponse* response) {
+    const string& prefix = request->prefix();
+    TRACELOG << "Getting metrics with prefix '" << prefix << "'" << endl;
+
+    {
+        Registry& registry = GetRegistry();
+        scoped_lock lock(registry.mutex);
+        auto& values = *response->mutable_values();
+        for (auto it = registry.metrics.lower_bound(prefix); it != registry.metrics.end(); ++it) {
+            if (0 != it->first.compare(0, prefix.size(), prefix)) {
+                break;
+            }
+            values[it->first] = it->second->Get();
+        }
+    }
+    ServerUnaryReactor* reactor = context->DefaultReactor();
+    reactor->Finish(Status::OK);
+    return reactor;
+}
+
+// Created on first use, so that metrics can be registered by static objects
+// of any translation unit
+Metrics::Registry& Metrics::GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+Metric& Metrics::Register(const string& name) {
+    Registry& registry = GetRegistry();
+    scoped_lock lock(registry.mutex);
+    auto& metric = registry.metrics[name];
+    if (!metric) {
+        metric = make_unique<Metric>();
+    }
+    return *metric;
+}
+
+double Metrics::Get(const string& name) {
+    Registry& registry = GetRegistry();
+    scoped_lock lock(registry.mutex);
+    auto it = registry.metrics.find(name);
+    return registry.metrics.end() == it ? 0 : it->second->Get();
+}
+
+void Metric::Add(double value) {
+    double current = _value.load(memory_order_relaxed);
+    while (!_value.compare_exchange_weak(current, current + value, memory_order_relaxed)) {
+    }
+}
+
+void Metric::SetMax(double value) {
+    double current = _value.load(memory_order_relaxed);
+    while (value > current &&
+           !_value.compare_exchange_weak(current, value, memory_order_relaxed)) {
+    }
+}
+}  // namespace acap_runtime
@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "metrics.grpc.pb.h"
+
+namespace acap_runtime {
+
+// A counter or gauge. Updates are lock free, so they can be made while other
+// locks are held.
+class Metric {
+  public:
+    // Increment a counter
+    void Add(double value = 1);
+    // Set the value of a gauge
+    void Set(double value) { _value.store(value, std::memory_order_relaxed); }
+    // Raise a gauge if value is above its current value
+    void SetMax(double value);
+    double Get() const { return _value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<double> _value{0};
+};
+
+// Process wide counters and gauges, readable through the Metrics service
+class Metrics final : public metrics::v1::Metrics::CallbackService {
+  public:
+    using CallbackServerContext = grpc::CallbackServerContext;
+    using GetMetricsRequest = metrics::v1::GetMetricsRequest;
+    using GetMetricsResponse = metrics::v1::GetMetricsResponse;
+    using ServerUnaryReactor = grpc::ServerUnaryReactor;
+
+    Metrics(bool verbose);
+
+    // Served directly on the gRPC thread, as it never blocks
+    ServerUnaryReactor* GetMetrics(CallbackServerContext* context,
+                                   const GetMetricsRequest* request,
+                                   GetMetricsResponse* response) override;
+
+    // Look up a metric, which is created on first use and is never removed.
+    // Metrics updated often or while other locks are held are looked up once
+    // and kept, the calls by name below look them up every time.
+    static Metric& Register(const std::string& name);
+
+    // Increment a counter
+    static void Add(const std::string& name, double value = 1) { Register(name).Add(value); }
+    // Set the value of a gauge
+    static void Set(const std::string& name, double value) { Register(name).Set(value); }
+    // Raise a gauge if value is above its current value
+    static void SetMax(const std::string& name, double value) { Register(name).SetMax(value); }
+    static double Get(const std::string& name);
+
+  private:
+    struct Registry {
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<Metric>> metrics;  // Guarded by mutex
+    };
+    static Registry& GetRegistry();
+
+    bool _verbose;
+};
+}  // namespace acap_runtime
+
+#endif
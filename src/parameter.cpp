@@ -28,7 +28,7 @@ using namespace std;
 
 namespace acap_runtime {
 
-Parameter::Parameter(bool verbose) : _verbose(verbose) {
+Parameter::Parameter(bool verbose, WorkerPool* workers) : _verbose(verbose), _workers(workers) {
     TRACELOG << "Init" << endl;
     GError* error = nullptr;
     ax_parameter = ax_parameter_new(APP_NAME, &error);
@@ -43,7 +43,15 @@ Parameter::~Parameter() {
     ax_parameter_free(ax_parameter);
 }
 
-Status Parameter::GetValues(ServerContext* context, const Request* request, Response* response) {
+ServerUnaryReactor* Parameter::GetValues(CallbackServerContext* context,
+                                         const Request* request,
+                                         Response* response) {
+    return Dispatch(_workers, context, [this, request, response] {
+        return GetValues(request, response);
+    });
+}
+
+Status Parameter::GetValues(const Request* request, Response* response) {
     const gchar* parameter_key = request->key().c_str();
     const regex pattern("[a-zA-Z0-9.]+");
     if (!regex_match(parameter_key, pattern)) {
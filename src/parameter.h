@@ -15,6 +15,7 @@
  */
 
 #include "keyvaluestore.grpc.pb.h"
+#include "worker_pool.h"
 #include <axsdk/axparameter.h>
 
 #ifdef TEST
@@ -26,20 +27,26 @@
 namespace acap_runtime {
 
 // Logic and data behind the server's behavior.
-class Parameter final : public keyvaluestore::KeyValueStore::Service {
+class Parameter final : public keyvaluestore::KeyValueStore::CallbackService {
   public:
+    using CallbackServerContext = grpc::CallbackServerContext;
     using Request = keyvaluestore::Request;
     using Response = keyvaluestore::Response;
-    using ServerContext = grpc::ServerContext;
+    using ServerUnaryReactor = grpc::ServerUnaryReactor;
     using Status = grpc::Status;
 
-    Parameter(bool verbose);
+    Parameter(bool verbose, WorkerPool* workers = nullptr);
     ~Parameter();
 
   private:
-    Status GetValues(ServerContext* context, const Request* request, Response* response) override;
+    // Run on the worker pool, as reading a parameter is a D-Bus call
+    ServerUnaryReactor* GetValues(CallbackServerContext* context,
+                                  const Request* request,
+                                  Response* response) override;
+    Status GetValues(const Request* request, Response* response);
 
     AXParameter* ax_parameter;
     bool _verbose;
+    WorkerPool* _workers;
 };
 }  // namespace acap_runtime
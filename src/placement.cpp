@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "placement.h"
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+#define ERRORLOG cerr << "ERROR in Placement: "
+
+namespace acap_runtime {
+
+Placement::Placement(const string& file) : _file(file) {
+    Load();
+}
+
+bool Placement::Find(const string& model,
+                     const uint64_t size,
+                     const int64_t mtime,
+                     PlacementRecord& record) const {
+    auto it = _records.find(model);
+    if (_records.end() == it || size != it->second.size || mtime != it->second.mtime) {
+        return false;
+    }
+    record = it->second;
+    return true;
+}
+
+bool Placement::Store(const string& model, const PlacementRecord& record) {
+    _records[model] = record;
+    return Save();
+}
+
+uint64_t Placement::Fastest(const map<uint64_t, double>& latencies) {
+    uint64_t fastest = 0;
+    double fastestLatency = 0;
+    for (auto& [chip, latency] : latencies) {
+        if (0 == fastest || latency < fastestLatency) {
+            fastest = chip;
+            fastestLatency = latency;
+        }
+    }
+    return fastest;
+}
+
+// Read the records of the file, malformed lines are skipped
+void Placement::Load() {
+    if (_file.empty()) {
+        return;
+    }
+    ifstream in(_file);
+    string line;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        string model;
+        string latencies;
+        PlacementRecord record;
+        if (!getline(fields, model, '\t') ||
+            !(fields >> record.size >> record.mtime >> record.chip >> latencies)) {
+            continue;
+        }
+
+        istringstream pairs(latencies);
+        string pair;
+        while (getline(pairs, pair, ',')) {
+            uint64_t chip;
+            double latency;
+            if (2 == sscanf(pair.c_str(), "%" SCNu64 ":%lf", &chip, &latency)) {
+                record.latencies[chip] = latency;
+            }
+        }
+        _records[model] = record;
+    }
+}
+
+// Write all records to a new file that replaces the old one, so that a
+// crash never leaves a partial file behind
+bool Placement::Save() const {
+    if (_file.empty()) {
+        return true;
+    }
+    const string tmpFile = _file + ".tmp";
+    {
+        ofstream out(tmpFile, ios::trunc);
+        for (auto& [model, record] : _records) {
+            out << model << '\t' << record.size << '\t' << record.mtime << '\t' << record.chip
+                << '\t';
+            const char* separator = "";
+            for (auto& [chip, latency] : record.latencies) {
+                out << separator << chip << ':' << latency;
+                separator = ",";
+            }
+            out << '\n';
+        }
+        if (!out.flush()) {
+            ERRORLOG << "Failed to write " << tmpFile << endl;
+            return false;
+        }
+    }
+    if (0 != rename(tmpFile.c_str(), _file.c_str())) {
+        ERRORLOG << "Failed to replace " << _file << endl;
+        return false;
+    }
+    return true;
+}
+}  // namespace acap_runtime
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <map>
+#include <string>
+
+namespace acap_runtime {
+
+// Measured latency in ms of a model on each chip it could be loaded on
+struct PlacementRecord {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t chip;
+    std::map<uint64_t, double> latencies;
+};
+
+/**
+ * @brief Chip placement decisions of models, persisted in a file
+ *
+ * Each line of the file holds the model file, its size and modification time,
+ * the selected chip and the latency measured on every chip, separated by tabs.
+ * A record is only valid as long as the model file is unchanged.
+ */
+class Placement {
+  public:
+    Placement(const std::string& file);
+
+    // Get the record of a model file, returns false if there is none or the
+    // file has been changed since it was benchmarked
+    bool Find(const std::string& model,
+              const uint64_t size,
+              const int64_t mtime,
+              PlacementRecord& record) const;
+    // Add or replace the record of a model file and save all records
+    bool Store(const std::string& model, const PlacementRecord& record);
+
+    // The chip with the lowest latency
+    static uint64_t Fastest(const std::map<uint64_t, double>& latencies);
+
+  private:
+    void Load();
+    bool Save() const;
+
+    std::string _file;
+    std::map<std::string, PlacementRecord> _records;
+};
+}  // namespace acap_runtime
+
+#endif
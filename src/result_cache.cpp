@@ -0,0 +1,165 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "result_cache.h"
+#include "metrics.h"
+#include <cstring>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace acap_runtime {
+
+const uint64_t HASH_PRIME = 0x9e3779b97f4a7c15ULL;
+
+// Metrics of all caches, looked up once since they are updated with _mutex held
+static Metric& hitsMetric = Metrics::Register("cache.hits");
+static Metric& missesMetric = Metrics::Register("cache.misses");
+static Metric& expiredMetric = Metrics::Register("cache.expired");
+static Metric& evictionsMetric = Metrics::Register("cache.evictions");
+static Metric& entriesMetric = Metrics::Register("cache.entries");
+static Metric& bytesMetric = Metrics::Register("cache.bytes");
+
+// Final mix of the MurmurHash3 64-bit hash
+inline uint64_t Mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline uint64_t Round(uint64_t hash, const uint8_t* data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    hash ^= word * HASH_PRIME;
+    return ((hash << 31) | (hash >> 33)) * HASH_PRIME;
+}
+
+ResultCache::ResultCache(const size_t maxEntries, const unsigned int ttlMs, const size_t maxBytes)
+    : _maxEntries(maxEntries), _ttl(milliseconds(ttlMs)), _maxBytes(maxBytes) {}
+
+bool ResultCache::Lookup(const string& key, PredictResponse& response) {
+    if (key.empty()) {
+        return false;
+    }
+    shared_ptr<const PredictResponse> result;
+    {
+        scoped_lock lock(_mutex);
+        auto it = _index.find(key);
+        if (_index.end() == it) {
+            missesMetric.Add();
+            return false;
+        }
+        if (Clock::now() >= it->second->expires) {
+            Erase(it->second);
+            UpdateSize();
+            expiredMetric.Add();
+            missesMetric.Add();
+            return false;
+        }
+        _entries.splice(_entries.begin(), _entries, it->second);
+        result = it->second->response;
+    }
+
+    // Copy outside of the lock, the entry may be evicted meanwhile
+    hitsMetric.Add();
+    response.CopyFrom(*result);
+    return true;
+}
+
+void ResultCache::Insert(const string& key,
+                         const PredictResponse& response,
+                         const uint64_t generation) {
+    if (!Enabled() || key.empty()) {
+        return;
+    }
+    // Results larger than the whole cache are not kept
+    const size_t size = key.size() + response.ByteSizeLong();
+    if (0 < _maxBytes && size > _maxBytes) {
+        return;
+    }
+    auto result = make_shared<const PredictResponse>(response);
+
+    scoped_lock lock(_mutex);
+    if (generation != _generation) {
+        return;
+    }
+    auto it = _index.find(key);
+    if (_index.end() != it) {
+        Erase(it->second);
+    }
+    _entries.push_front(Entry{key, Clock::now() + _ttl, result, size});
+    _index[key] = _entries.begin();
+    _bytes += size;
+    while (_entries.size() > _maxEntries || (0 < _maxBytes && _bytes > _maxBytes)) {
+        Erase(prev(_entries.end()));
+        evictionsMetric.Add();
+    }
+    UpdateSize();
+}
+
+void ResultCache::Clear() {
+    scoped_lock lock(_mutex);
+    _entries.clear();
+    _index.clear();
+    _bytes = 0;
+    _generation++;
+    UpdateSize();
+}
+
+uint64_t ResultCache::Generation() {
+    scoped_lock lock(_mutex);
+    return _generation;
+}
+
+// Four independent lanes of 8 bytes keep the multipliers busy on large inputs
+uint64_t ResultCache::Hash(const void* data, const size_t size, const uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t lanes[4] = {seed, seed + HASH_PRIME, seed ^ Mix(size), seed - HASH_PRIME};
+
+    for (; end - p >= 32; p += 32) {
+        lanes[0] = Round(lanes[0], p);
+        lanes[1] = Round(lanes[1], p + 8);
+        lanes[2] = Round(lanes[2], p + 16);
+        lanes[3] = Round(lanes[3], p + 24);
+    }
+    for (; end - p >= 8; p += 8) {
+        lanes[0] = Round(lanes[0], p);
+    }
+    uint8_t tail[8] = {0};
+    memcpy(tail, p, end - p);
+    lanes[1] = Round(lanes[1], tail);
+
+    return Mix(Mix(lanes[0]) ^ (Mix(lanes[1]) * 3) ^ (Mix(lanes[2]) * 5) ^ (Mix(lanes[3]) * 7) ^
+               size);
+}
+
+// NB! Must be called with _mutex held
+void ResultCache::Erase(list<Entry>::iterator entry) {
+    _bytes -= entry->size;
+    _index.erase(entry->key);
+    _entries.erase(entry);
+}
+
+// NB! Must be called with _mutex held
+void ResultCache::UpdateSize() {
+    entriesMetric.Set(_entries.size());
+    bytesMetric.Set(_bytes);
+}
+}  // namespace acap_runtime
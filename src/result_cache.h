@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "predict.pb.h"
+
+namespace acap_runtime {
+
+/**
+ * @brief Bounded cache of prediction results
+ *
+ * Results are kept for a limited time and the least recently used result is
+ * evicted when the cache is full, by number of entries or by size. A cache
+ * with no entries is disabled.
+ */
+class ResultCache {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using PredictResponse = tensorflow::serving::PredictResponse;
+
+    // A max size of 0 bounds the cache by number of entries only
+    ResultCache(const size_t maxEntries, const unsigned int ttlMs, const size_t maxBytes = 0);
+
+    bool Enabled() const { return _maxEntries > 0; }
+
+    // Copy a cached result into response, returns false on a miss. An empty
+    // key is never cached and is not counted as a miss.
+    bool Lookup(const std::string& key, PredictResponse& response);
+    // Insert a result, unless the cache has been cleared since generation was
+    // taken, at the start of the request
+    void Insert(const std::string& key,
+                const PredictResponse& response,
+                const uint64_t generation);
+    // Remove all results, e.g. when a model has been replaced
+    void Clear();
+    uint64_t Generation();
+
+    // Fast non-cryptographic hash of a block of memory
+    static uint64_t Hash(const void* data, const size_t size, const uint64_t seed = 0);
+
+  private:
+    struct Entry {
+        std::string key;
+        Clock::time_point expires;
+        std::shared_ptr<const PredictResponse> response;
+        size_t size;
+    };
+
+    void Erase(std::list<Entry>::iterator entry);
+    void UpdateSize();
+
+    size_t _maxEntries;
+    Clock::duration _ttl;
+    size_t _maxBytes;
+    size_t _bytes = 0;  // Size of all entries, guarded by _mutex
+    uint64_t _generation = 0;  // Count of clears, guarded by _mutex
+    std::list<Entry> _entries;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    std::mutex _mutex;
+};
+}  // namespace acap_runtime
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "runtime.h"
+
+using namespace grpc;
+using namespace std;
+
+namespace acap_runtime {
+
+inline WorkerPool* NewWorkerPool(const unsigned int numThreads) {
+    return 0 < numThreads ? new WorkerPool(numThreads) : nullptr;
+}
+
+Runtime::Runtime(const RuntimeSettings& settings)
+    : _workers(NewWorkerPool(settings.workerThreads)),
+      _capture(settings.verbose, _workers.get(), settings.capture),
+      _inference(settings.verbose,
+                 settings.chipId,
+                 settings.models,
+                 &_capture,
+                 settings.inference,
+                 _workers.get()) {}
+
+// The calls have no server context, so they have no deadline and are not
+// cancelled. The blocking overloads of the services are called directly.
+Status Runtime::Predict(const PredictRequest& request, PredictResponse& response) {
+    return _inference.Predict(static_cast<ServerContextBase*>(nullptr), &request, &response);
+}
+
+void Runtime::Predict(const PredictRequest& request,
+                      PredictResponse& response,
+                      Inference::PredictDoneFunc done) {
+    _inference.Predict(&request, &response, move(done));
+}
+
+Status Runtime::GetModelMetadata(const GetModelMetadataRequest& request,
+                                 GetModelMetadataResponse& response) {
+    return _inference.GetModelMetadata(
+        static_cast<ServerContextBase*>(nullptr), &request, &response);
+}
+
+Status Runtime::NewStream(const NewStreamRequest& request, NewStreamResponse& response) {
+    return _capture.NewStream(static_cast<ServerContextBase*>(nullptr), &request, &response);
+}
+
+Status Runtime::DeleteStream(const DeleteStreamRequest& request, DeleteStreamResponse& response) {
+    return _capture.DeleteStream(static_cast<ServerContextBase*>(nullptr), &request, &response);
+}
+
+Status Runtime::GetFrame(const GetFrameRequest& request, GetFrameResponse& response) {
+    return _capture.GetFrame(static_cast<ServerContextBase*>(nullptr), &request, &response);
+}
+
+bool Runtime::ReloadModel(const string& modelFile) {
+    return _inference.ReloadModel(modelFile);
+}
+
+void Runtime::ReloadModels() {
+    _inference.ReloadModels();
+}
+}  // namespace acap_runtime
@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "inference.h"
+#include "video_capture.h"
+#include "worker_pool.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace acap_runtime {
+
+// Settings of an embedded runtime
+struct RuntimeSettings {
+    bool verbose = false;
+    // Chip id, see larodChip in larod.h
+    uint64_t chipId = 0;
+    // Model files loaded at start
+    std::vector<std::string> models;
+    InferenceSettings inference;
+    CaptureSettings capture;
+    // Threads that run the blocking calls of gRPC services, 0 to run them on
+    // the gRPC threads. Not used by the calls of the runtime itself.
+    unsigned int workerThreads = std::thread::hardware_concurrency();
+};
+
+/**
+ * @brief Inference and video capture inside the process of an application
+ *
+ * Calls are made directly on the services, without serialization or a socket
+ * in between, and are run on the thread of the caller. The gRPC server of
+ * acapruntime is a thin layer on top, which registers the same services.
+ */
+class Runtime {
+  public:
+    using DeleteStreamRequest = Capture::DeleteStreamRequest;
+    using DeleteStreamResponse = Capture::DeleteStreamResponse;
+    using GetFrameRequest = Capture::GetFrameRequest;
+    using GetFrameResponse = Capture::GetFrameResponse;
+    using GetModelMetadataRequest = Inference::GetModelMetadataRequest;
+    using GetModelMetadataResponse = Inference::GetModelMetadataResponse;
+    using NewStreamRequest = Capture::NewStreamRequest;
+    using NewStreamResponse = Capture::NewStreamResponse;
+    using PredictRequest = Inference::PredictRequest;
+    using PredictResponse = Inference::PredictResponse;
+    using Status = grpc::Status;
+
+    explicit Runtime(const RuntimeSettings& settings);
+
+    Status Predict(const PredictRequest& request, PredictResponse& response);
+    // Predict without holding a thread while the request is queued, see
+    // Inference::Predict
+    void Predict(const PredictRequest& request,
+                 PredictResponse& response,
+                 Inference::PredictDoneFunc done);
+    Status GetModelMetadata(const GetModelMetadataRequest& request,
+                            GetModelMetadataResponse& response);
+
+    Status NewStream(const NewStreamRequest& request, NewStreamResponse& response);
+    Status DeleteStream(const DeleteStreamRequest& request, DeleteStreamResponse& response);
+    Status GetFrame(const GetFrameRequest& request, GetFrameResponse& response);
+
+    // Load a new version of a model file in place of the loaded one
+    bool ReloadModel(const std::string& modelFile);
+    // Reload all loaded models in the background
+    void ReloadModels();
+
+    // Services and worker pool for a gRPC server, which must be shut down
+    // before the runtime is destroyed
+    Inference& InferenceService() { return _inference; }
+    Capture& CaptureService() { return _capture; }
+    WorkerPool* Workers() { return _workers.get(); }
+
+  private:
+    // Declared in order of construction, the pool outlives the services
+    std::unique_ptr<WorkerPool> _workers;
+    Capture _capture;
+    Inference _inference;
+};
+}  // namespace acap_runtime
+
+#endif
@@ -0,0 +1,498 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scheduler.h"
+#include "metrics.h"
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace std::chrono;
+
+#define TRACELOG  \
+    if (_verbose) \
+    cout << "TRACE in Scheduler: "
+
+namespace acap_runtime {
+
+const char* const PRIORITY_NAMES[NBR_PRIORITIES] = {"high", "normal", "low"};
+
+// Weight of the latest execution time in the model cost estimate
+const double COST_SMOOTHING = 0.2;
+
+// How often a queued request checks if its client has cancelled it
+const auto CANCEL_POLL_INTERVAL = milliseconds(50);
+
+// Metrics of all schedulers, looked up once since they are updated with _mutex held
+static Metric& admittedMetric = Metrics::Register("scheduler.admitted");
+static Metric& rejectedMetric = Metrics::Register("scheduler.rejected");
+static Metric& promotedMetric = Metrics::Register("scheduler.promoted");
+static Metric& inFlightMetric = Metrics::Register("scheduler.in_flight");
+static Metric& cancelledMetric = Metrics::Register("scheduler.dropped.cancelled");
+static Metric& deadlineMetric = Metrics::Register("scheduler.dropped.deadline");
+
+// Metrics of a priority class
+struct ClassMetrics {
+    Metric& dispatched;
+    Metric& waitMs;
+    Metric& queueDepth;
+    Metric& maxQueueDepth;
+};
+
+static ClassMetrics& GetClassMetrics(const Priority priority) {
+    static vector<ClassMetrics> metrics = [] {
+        vector<ClassMetrics> metrics;
+        for (auto name : PRIORITY_NAMES) {
+            const string prefix = string("scheduler.") + name;
+            metrics.push_back(ClassMetrics{Metrics::Register(prefix + ".dispatched"),
+                                           Metrics::Register(prefix + ".wait_ms"),
+                                           Metrics::Register(prefix + ".queue_depth"),
+                                           Metrics::Register(prefix + ".max_queue_depth")});
+        }
+        return metrics;
+    }();
+    return metrics[static_cast<size_t>(priority)];
+}
+
+Scheduler::Scheduler(const bool verbose,
+                     const unsigned int starvationLimitMs,
+                     const map<string, double>& weights,
+                     const unsigned int maxInFlight,
+                     const map<string, unsigned int>& modelMaxInFlight,
+                     const unsigned int capacity)
+    : _verbose(verbose), _starvationLimit(milliseconds(starvationLimitMs)), _weights(weights),
+      _maxInFlight(maxInFlight), _modelMaxInFlight(modelMaxInFlight),
+      _busy(max(1u, capacity), false) {
+    TRACELOG << "Init starvation limit " << starvationLimitMs << " ms, max in flight "
+             << maxInFlight << endl;
+}
+
+Priority Scheduler::ParsePriority(const string& name) {
+    for (size_t i = 0; i < NBR_PRIORITIES; i++) {
+        if (name == PRIORITY_NAMES[i]) {
+            return static_cast<Priority>(i);
+        }
+    }
+    return Priority::NORMAL;
+}
+
+const char* Scheduler::PriorityName(const Priority priority) {
+    return PRIORITY_NAMES[static_cast<size_t>(priority)];
+}
+
+Scheduler::Result Scheduler::Acquire(const Priority priority,
+                                     const string& client,
+                                     const string& model,
+                                     const Clock::time_point deadline,
+                                     const CancelledFunc& isCancelled,
+                                     unsigned int* replica) {
+    auto scheduled = make_shared<promise<pair<Result, unsigned int>>>();
+    auto result = scheduled->get_future();
+    Enqueue(priority,
+            client,
+            model,
+            deadline,
+            isCancelled,
+            [scheduled](const Result result, const unsigned int replica) {
+                scheduled->set_value({result, replica});
+            });
+
+    // Wait, while checking that the request is still wanted and can finish in time
+    while (future_status::ready !=
+           result.wait_for(min<Clock::duration>(CANCEL_POLL_INTERVAL, deadline - Clock::now()))) {
+        Callbacks callbacks;
+        {
+            scoped_lock lock(_mutex);
+            Schedule(callbacks);
+        }
+        for (auto& callback : callbacks) {
+            callback();
+        }
+    }
+    auto [acquired, selected] = result.get();
+    if (nullptr != replica) {
+        *replica = selected;
+    }
+    return acquired;
+}
+
+uint64_t Scheduler::Enqueue(const Priority priority,
+                            const string& client,
+                            const string& model,
+                            const Clock::time_point deadline,
+                            const CancelledFunc& isCancelled,
+                            DoneFunc done) {
+    Callbacks callbacks;
+    uint64_t id;
+    {
+        scoped_lock lock(_mutex);
+        id = _nextId++;
+        if (Admit(model)) {
+            // Tag the request with the virtual time at which its flow may start
+            const string flow = client + "/" + model;
+            auto cost = _modelCost.find(model);
+            double& finishTag = _flowFinishTags[flow];
+            const double startTag = max(_virtualTime, finishTag);
+            finishTag =
+                startTag + (_modelCost.end() == cost ? 1 : cost->second) / Weight(client, model);
+
+            auto& queue = _queues[static_cast<size_t>(priority)];
+            queue.push_back(Entry{id,
+                                  priority,
+                                  client,
+                                  model,
+                                  startTag,
+                                  Clock::now(),
+                                  deadline,
+                                  isCancelled,
+                                  move(done)});
+            UpdateQueueDepth(priority);
+            Schedule(callbacks);
+        } else {
+            TRACELOG << "Rejecting " << PriorityName(priority) << " request from " << client
+                     << ", " << _inFlight << " requests in flight" << endl;
+            rejectedMetric.Add();
+            callbacks.push_back([done = move(done)] { done(Result::REJECTED, NO_REPLICA); });
+        }
+    }
+    for (auto& callback : callbacks) {
+        callback();
+    }
+    return id;
+}
+
+void Scheduler::Cancel(const uint64_t ticket) {
+    Callbacks callbacks;
+    {
+        scoped_lock lock(_mutex);
+        for (auto& queue : _queues) {
+            auto entry = find_if(
+                queue.begin(), queue.end(), [ticket](const Entry& e) { return ticket == e.id; });
+            if (queue.end() != entry) {
+                Drop(entry, "cancelled", cancelledMetric, callbacks);
+                Schedule(callbacks);
+                break;
+            }
+        }
+    }
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
+
+void Scheduler::Release(const string& model,
+                        const unsigned int replica,
+                        const Clock::duration executionTime) {
+    Callbacks callbacks;
+    {
+        scoped_lock lock(_mutex);
+        const double cost = duration<double, milli>(executionTime).count();
+        auto it = _modelCost.find(model);
+        if (_modelCost.end() == it) {
+            _modelCost[model] = cost;
+        } else {
+            it->second += COST_SMOOTHING * (cost - it->second);
+        }
+        auto& costs = _replicaCost[model];
+        auto replicaCost = costs.find(replica);
+        if (costs.end() == replicaCost) {
+            costs[replica] = cost;
+        } else {
+            replicaCost->second += COST_SMOOTHING * (cost - replicaCost->second);
+        }
+
+        // Flows that have caught up with virtual time carry no state
+        for (auto flow = _flowFinishTags.begin(); flow != _flowFinishTags.end();) {
+            flow = flow->second <= _virtualTime ? _flowFinishTags.erase(flow) : next(flow);
+        }
+        _running--;
+        if (replica < _busy.size()) {
+            _busy[replica] = false;
+        }
+        auto running = _runningModels.find(model);
+        if (0 == --running->second) {
+            _runningModels.erase(running);
+        }
+        Leave(model);
+        Schedule(callbacks);
+    }
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
+
+Scheduler::Clock::duration Scheduler::Backlog() {
+    scoped_lock lock(_mutex);
+    auto backlog = Clock::duration::zero();
+    for (auto& [model, count] : _runningModels) {
+        backlog += count * ExpectedCost(model);
+    }
+    for (auto& queue : _queues) {
+        for (auto& entry : queue) {
+            backlog += ExpectedCost(entry.model);
+        }
+    }
+    return backlog / _busy.size();
+}
+
+void Scheduler::SetCapacity(const unsigned int capacity) {
+    Callbacks callbacks;
+    {
+        scoped_lock lock(_mutex);
+        _busy.resize(max(1u, capacity), false);
+        Schedule(callbacks);
+    }
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
+
+void Scheduler::PlaceModel(const string& model, const set<unsigned int>& replicas) {
+    Callbacks callbacks;
+    {
+        scoped_lock lock(_mutex);
+        _modelReplicas[model] = replicas;
+        Schedule(callbacks);
+    }
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
+
+// Drop the queued requests that are no longer wanted or can not finish in
+// time, then start the next requests while there is capacity
+// NB! Must be called with _mutex held
+void Scheduler::Schedule(Callbacks& callbacks) {
+    const auto now = Clock::now();
+    for (auto& queue : _queues) {
+        for (auto entry = queue.begin(); entry != queue.end();) {
+            auto current = entry++;
+            if (current->isCancelled && current->isCancelled()) {
+                Drop(current, "cancelled", cancelledMetric, callbacks);
+            } else if (now >= current->deadline - ExpectedCost(current->model)) {
+                Drop(current, "deadline", deadlineMetric, callbacks);
+            }
+        }
+    }
+    // The requests in flight that are not running are queued
+    list<Entry>::iterator next;
+    unsigned int replica;
+    while (_inFlight > _running && Next(next, replica)) {
+        Start(next, replica, callbacks);
+    }
+}
+
+// Select the next request to run and its replica, among the requests whose
+// model is held by an idle replica. Returns false if there is none.
+// NB! Must be called with _mutex held
+bool Scheduler::Next(list<Entry>::iterator& next, unsigned int& replica) {
+    map<string, unsigned int> idle;
+    auto runnable = [this, &idle](const Entry& entry) {
+        auto it = idle.find(entry.model);
+        if (idle.end() == it) {
+            it = idle.emplace(entry.model, IdleReplica(entry.model)).first;
+        }
+        return NO_REPLICA != it->second;
+    };
+
+    // Serve the oldest starved request first
+    bool found = false;
+    if (_starvationLimit.count() > 0) {
+        const auto starved = Clock::now() - _starvationLimit;
+        for (size_t i = 1; i < NBR_PRIORITIES; i++) {
+            auto& queue = _queues[i];
+            auto oldest = find_if(queue.begin(), queue.end(), runnable);
+            if (queue.end() != oldest && oldest->enqueued <= starved &&
+                (!found || oldest->enqueued < next->enqueued)) {
+                next = oldest;
+                found = true;
+            }
+        }
+    }
+
+    // Otherwise the smallest start tag of the highest priority class
+    for (size_t i = 0; !found && i < NBR_PRIORITIES; i++) {
+        auto& queue = _queues[i];
+        for (auto entry = queue.begin(); entry != queue.end(); entry++) {
+            if (runnable(*entry) && (!found || entry->startTag < next->startTag)) {
+                next = entry;
+                found = true;
+            }
+        }
+    }
+    if (found) {
+        replica = idle[next->model];
+    }
+    return found;
+}
+
+// The idle replica holding a model with the lowest measured execution time of
+// it, where replicas that have not run the model yet are tried first. Returns
+// NO_REPLICA if every replica holding the model is busy.
+// NB! Must be called with _mutex held
+unsigned int Scheduler::IdleReplica(const string& model) {
+    auto placed = _modelReplicas.find(model);
+    auto costs = _replicaCost.find(model);
+    unsigned int selected = NO_REPLICA;
+    double selectedCost = 0;
+    for (unsigned int replica = 0; replica < _busy.size(); replica++) {
+        if (_busy[replica] ||
+            (_modelReplicas.end() != placed && 0 == placed->second.count(replica))) {
+            continue;
+        }
+        double cost = 0;
+        if (_replicaCost.end() != costs) {
+            auto it = costs->second.find(replica);
+            cost = costs->second.end() == it ? 0 : it->second;
+        }
+        if (NO_REPLICA == selected || cost < selectedCost) {
+            selected = replica;
+            selectedCost = cost;
+        }
+    }
+    return selected;
+}
+
+// Measured execution time of a model, zero until it has run once
+Scheduler::Clock::duration Scheduler::ExpectedCost(const string& model) {
+    auto it = _modelCost.find(model);
+    if (_modelCost.end() == it) {
+        return Clock::duration::zero();
+    }
+    return duration_cast<Clock::duration>(duration<double, milli>(it->second));
+}
+
+// Count a new request as in flight, unless that would exceed a limit
+// NB! Must be called with _mutex held
+bool Scheduler::Admit(const string& model) {
+    auto limit = _modelMaxInFlight.find(model);
+    auto current = _modelInFlight.find(model);
+    const unsigned int modelInFlight = _modelInFlight.end() == current ? 0 : current->second;
+    if ((_maxInFlight > 0 && _inFlight >= _maxInFlight) ||
+        (_modelMaxInFlight.end() != limit && modelInFlight >= limit->second)) {
+        return false;
+    }
+    _inFlight++;
+    _modelInFlight[model]++;
+    inFlightMetric.Set(_inFlight);
+    admittedMetric.Add();
+    return true;
+}
+
+// Move a request from the queue to execution on a replica
+// NB! Must be called with _mutex held
+void Scheduler::Start(list<Entry>::iterator entry,
+                      const unsigned int replica,
+                      Callbacks& callbacks) {
+    const Priority priority = entry->priority;
+
+    // Check if the request was promoted past a higher priority class
+    const auto waited = Clock::now() - entry->enqueued;
+    for (size_t i = 0; i < static_cast<size_t>(priority); i++) {
+        if (!_queues[i].empty()) {
+            promotedMetric.Add();
+            TRACELOG << "Promoted " << PriorityName(priority) << " request from "
+                     << entry->client << " after "
+                     << duration_cast<milliseconds>(waited).count() << " ms" << endl;
+            break;
+        }
+    }
+
+    _running++;
+    _busy[replica] = true;
+    _runningModels[entry->model]++;
+    _virtualTime = max(_virtualTime, entry->startTag);
+    callbacks.push_back([done = move(entry->done), replica] { done(Result::ACQUIRED, replica); });
+    _queues[static_cast<size_t>(priority)].erase(entry);
+    UpdateQueueDepth(priority);
+
+    ClassMetrics& metrics = GetClassMetrics(priority);
+    metrics.dispatched.Add();
+    metrics.waitMs.Add(duration<double, milli>(waited).count());
+}
+
+// Remove a request from the queue without running it
+// NB! Must be called with _mutex held
+void Scheduler::Drop(list<Entry>::iterator entry,
+                     const char* reason,
+                     Metric& dropped,
+                     Callbacks& callbacks) {
+    const Priority priority = entry->priority;
+    TRACELOG << "Dropping queued " << PriorityName(priority) << " request (" << reason << ")"
+             << endl;
+    Leave(entry->model);
+    callbacks.push_back([done = move(entry->done)] { done(Result::DROPPED, NO_REPLICA); });
+    _queues[static_cast<size_t>(priority)].erase(entry);
+    UpdateQueueDepth(priority);
+    dropped.Add();
+}
+
+// Stop counting a request as in flight
+// NB! Must be called with _mutex held
+void Scheduler::Leave(const string& model) {
+    _inFlight--;
+    auto it = _modelInFlight.find(model);
+    if (0 == --it->second) {
+        _modelInFlight.erase(it);
+    }
+    inFlightMetric.Set(_inFlight);
+}
+
+// Weight of a flow, from the weights configured for its client and model
+double Scheduler::Weight(const string& client, const string& model) {
+    double weight = 1;
+    for (auto& name : {client, model}) {
+        auto it = _weights.find(name);
+        if (_weights.end() != it && it->second > 0) {
+            weight *= it->second;
+        }
+    }
+    return weight;
+}
+
+void Scheduler::UpdateQueueDepth(const Priority priority) {
+    ClassMetrics& metrics = GetClassMetrics(priority);
+    const double depth = _queues[static_cast<size_t>(priority)].size();
+    metrics.queueDepth.Set(depth);
+    metrics.maxQueueDepth.SetMax(depth);
+}
+
+Scheduler::Slot::Slot(Scheduler& scheduler,
+                      const Priority priority,
+                      const string& client,
+                      const string& model,
+                      const Clock::time_point deadline,
+                      const CancelledFunc& isCancelled)
+    : _scheduler(scheduler), _model(model) {
+    _result = _scheduler.Acquire(priority, client, model, deadline, isCancelled, &_replica);
+    _start = Clock::now();
+}
+
+Scheduler::Slot::Slot(Scheduler& scheduler,
+                      const string& model,
+                      const Result result,
+                      const unsigned int replica)
+    : _scheduler(scheduler), _result(result), _replica(replica), _model(model),
+      _start(Clock::now()) {}
+
+Scheduler::Slot::~Slot() {
+    if (Acquired()) {
+        _scheduler.Release(_model, _replica, Clock::now() - _start);
+    }
+}
+}  // namespace acap_runtime
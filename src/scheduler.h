@@ -0,0 +1,188 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace acap_runtime {
+
+class Metric;
+
+enum class Priority { HIGH = 0, NORMAL = 1, LOW = 2 };
+const size_t NBR_PRIORITIES = 3;
+
+/**
+ * @brief Orders requests waiting for larod execution
+ *
+ * Each replica, a larod connection, runs one request at a time, and a request
+ * is only started when a replica holding its model is idle. Of the idle
+ * replicas holding the model, the one with the lowest measured execution time
+ * of the model is picked, and a model that is not placed may run on any.
+ * Waiting requests are served in strict priority order between classes. Within a
+ * class, flows (one per client and model) share execution time in proportion
+ * to their weight using start-time fair queuing, with the cost of a request
+ * being the measured execution time of its model. If a starvation limit is
+ * set, a request that has waited longer than the limit is served next
+ * regardless of its priority.
+ *
+ * Requests are dropped from the queue if they are cancelled by the client or
+ * if their deadline cannot be met given the measured execution time of the
+ * model. If a limit on the number of requests in flight (queued or running) is
+ * set, globally or for a model, requests above the limit are rejected at once.
+ *
+ * Requests either block in Acquire until they are scheduled, or are queued
+ * with Enqueue and get a callback, so that they wait without holding a thread.
+ */
+class Scheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    Scheduler(const bool verbose,
+              const unsigned int starvationLimitMs,
+              const std::map<std::string, double>& weights,
+              const unsigned int maxInFlight = 0,
+              const std::map<std::string, unsigned int>& modelMaxInFlight = {},
+              const unsigned int capacity = 1);
+
+    using CancelledFunc = std::function<bool()>;
+    enum class Result { ACQUIRED, DROPPED, REJECTED };
+    // Called with the replica to run on, which is NO_REPLICA unless acquired
+    using DoneFunc = std::function<void(Result result, unsigned int replica)>;
+    static const unsigned int NO_REPLICA = UINT32_MAX;
+
+    // Block until the request is scheduled for execution on a replica, unless
+    // it is rejected or dropped from the queue
+    Result Acquire(const Priority priority,
+                 const std::string& client,
+                 const std::string& model,
+                 const Clock::time_point deadline = Clock::time_point::max(),
+                 const CancelledFunc& isCancelled = nullptr,
+                 unsigned int* replica = nullptr);
+    // Queue the request without blocking. Done is called once, when the request
+    // is scheduled for execution, rejected or dropped, which may be before
+    // Enqueue returns. Returns a ticket with which the request can be cancelled.
+    uint64_t Enqueue(const Priority priority,
+                     const std::string& client,
+                     const std::string& model,
+                     const Clock::time_point deadline,
+                     const CancelledFunc& isCancelled,
+                     DoneFunc done);
+    // Drop a queued request at once, does nothing if it is no longer queued
+    void Cancel(const uint64_t ticket);
+    // Hand over the replica to the next request
+    void Release(const std::string& model,
+                 const unsigned int replica,
+                 const Clock::duration executionTime);
+    // Estimated time until all requests in flight have been executed
+    Clock::duration Backlog();
+    // Set the number of replicas
+    void SetCapacity(const unsigned int capacity);
+    // Set the replicas that hold a model
+    void PlaceModel(const std::string& model, const std::set<unsigned int>& replicas);
+
+    static Priority ParsePriority(const std::string& name);
+    static const char* PriorityName(const Priority priority);
+
+    // Acquire for the lifetime of the object, in the style of std::scoped_lock
+    class Slot {
+      public:
+        Slot(Scheduler& scheduler,
+             const Priority priority,
+             const std::string& client,
+             const std::string& model,
+             const Clock::time_point deadline = Clock::time_point::max(),
+             const CancelledFunc& isCancelled = nullptr);
+        // Take over a request scheduled by Enqueue
+        Slot(Scheduler& scheduler,
+             const std::string& model,
+             const Result result,
+             const unsigned int replica);
+        ~Slot();
+
+        bool Acquired() const { return Result::ACQUIRED == _result; }
+        bool Rejected() const { return Result::REJECTED == _result; }
+        unsigned int Replica() const { return _replica; }
+
+      private:
+        Scheduler& _scheduler;
+        Result _result;
+        unsigned int _replica = NO_REPLICA;
+        std::string _model;
+        Clock::time_point _start;
+    };
+
+  private:
+    struct Entry {
+        uint64_t id;
+        Priority priority;
+        std::string client;
+        std::string model;
+        double startTag;
+        Clock::time_point enqueued;
+        Clock::time_point deadline;
+        CancelledFunc isCancelled;
+        DoneFunc done;
+    };
+    // Done functions to call once _mutex is released
+    using Callbacks = std::vector<std::function<void()>>;
+
+    void Schedule(Callbacks& callbacks);
+    bool Next(std::list<Entry>::iterator& next, unsigned int& replica);
+    unsigned int IdleReplica(const std::string& model);
+    Clock::duration ExpectedCost(const std::string& model);
+    bool Admit(const std::string& model);
+    void Start(std::list<Entry>::iterator entry, const unsigned int replica, Callbacks& callbacks);
+    void Drop(std::list<Entry>::iterator entry,
+              const char* reason,
+              Metric& dropped,
+              Callbacks& callbacks);
+    void Leave(const std::string& model);
+    double Weight(const std::string& client, const std::string& model);
+    void UpdateQueueDepth(const Priority priority);
+
+    bool _verbose;
+    Clock::duration _starvationLimit;
+    std::map<std::string, double> _weights;
+    unsigned int _maxInFlight;
+    std::map<std::string, unsigned int> _modelMaxInFlight;
+    unsigned int _inFlight = 0;
+    std::map<std::string, unsigned int> _modelInFlight;
+    std::vector<bool> _busy;  // Of each replica
+    std::map<std::string, std::set<unsigned int>> _modelReplicas;
+    std::map<std::string, unsigned int> _runningModels;
+    std::map<std::string, double> _flowFinishTags;
+    std::map<std::string, double> _modelCost;
+    // Execution time of a model on each replica it has run on
+    std::map<std::string, std::map<unsigned int, double>> _replicaCost;
+    std::list<Entry> _queues[NBR_PRIORITIES];
+    double _virtualTime = 0;
+    uint64_t _nextId = 0;
+    unsigned int _running = 0;
+    std::mutex _mutex;
+};
+}  // namespace acap_runtime
+
+#endif
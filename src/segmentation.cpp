@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "segmentation.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
+
+using namespace std;
+
+namespace acap_runtime {
+
+// Index of the first channel holding the max score of a pixel
+template <typename T>
+static inline uint8_t FirstIndexOf(const T* scores, size_t numChannels, T max) {
+    size_t c = 0;
+    while (c < numChannels - 1 && scores[c] != max) {
+        c++;
+    }
+    return static_cast<uint8_t>(c);
+}
+
+// Scalar argmax of a single pixel
+template <typename T>
+static inline uint8_t ArgmaxPixel(const T* scores, size_t numChannels) {
+    T max = scores[0];
+    uint8_t index = 0;
+    for (size_t c = 1; c < numChannels; c++) {
+        if (scores[c] > max) {
+            max = scores[c];
+            index = static_cast<uint8_t>(c);
+        }
+    }
+    return index;
+}
+
+#ifdef USE_NEON
+// Horizontal max of a vector
+static inline uint8_t MaxLane(uint8x16_t v) {
+#ifdef __aarch64__
+    return vmaxvq_u8(v);
+#else
+    uint8x8_t m = vpmax_u8(vget_low_u8(v), vget_high_u8(v));
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    return vget_lane_u8(m, 0);
+#endif
+}
+
+static inline int8_t MaxLane(int8x16_t v) {
+#ifdef __aarch64__
+    return vmaxvq_s8(v);
+#else
+    int8x8_t m = vpmax_s8(vget_low_s8(v), vget_high_s8(v));
+    m = vpmax_s8(m, m);
+    m = vpmax_s8(m, m);
+    m = vpmax_s8(m, m);
+    return vget_lane_s8(m, 0);
+#endif
+}
+
+static inline float MaxLane(float32x4_t v) {
+#ifdef __aarch64__
+    return vmaxvq_f32(v);
+#else
+    float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+#endif
+}
+#endif
+
+void ArgmaxChannels(const uint8_t* scores,
+                    size_t numPixels,
+                    size_t numChannels,
+                    uint8_t* classMap) {
+#ifdef USE_NEON
+    if (numChannels >= 16) {
+        for (size_t p = 0; p < numPixels; p++, scores += numChannels) {
+            uint8x16_t vmax = vld1q_u8(scores);
+            size_t c = 16;
+            for (; c + 16 <= numChannels; c += 16) {
+                vmax = vmaxq_u8(vmax, vld1q_u8(scores + c));
+            }
+            uint8_t max = MaxLane(vmax);
+            for (; c < numChannels; c++) {
+                max = scores[c] > max ? scores[c] : max;
+            }
+            classMap[p] = FirstIndexOf(scores, numChannels, max);
+        }
+        return;
+    }
+#endif
+    for (size_t p = 0; p < numPixels; p++, scores += numChannels) {
+        classMap[p] = ArgmaxPixel(scores, numChannels);
+    }
+}
+
+void ArgmaxChannels(const int8_t* scores, size_t numPixels, size_t numChannels, uint8_t* classMap) {
+#ifdef USE_NEON
+    if (numChannels >= 16) {
+        for (size_t p = 0; p < numPixels; p++, scores += numChannels) {
+            int8x16_t vmax = vld1q_s8(scores);
+            size_t c = 16;
+            for (; c + 16 <= numChannels; c += 16) {
+                vmax = vmaxq_s8(vmax, vld1q_s8(scores + c));
+            }
+            int8_t max = MaxLane(vmax);
+            for (; c < numChannels; c++) {
+                max = scores[c] > max ? scores[c] : max;
+            }
+            classMap[p] = FirstIndexOf(scores, numChannels, max);
+        }
+        return;
+    }
+#endif
+    for (size_t p = 0; p < numPixels; p++, scores += numChannels) {
+        classMap[p] = ArgmaxPixel(scores, numChannels);
+    }
+}
+
+void ArgmaxChannels(const float* scores, size_t numPixels, size_t numChannels, uint8_t* classMap) {
+#ifdef USE_NEON
+    if (numChannels >= 4) {
+        for (size_t p = 0; p < numPixels; p++, scores += numChannels) {
+            float32x4_t vmax = vld1q_f32(scores);
+            size_t c = 4;
+            for (; c + 4 <= numChannels; c += 4) {
+                vmax = vmaxq_f32(vmax, vld1q_f32(scores + c));
+            }
+            float max = MaxLane(vmax);
+            for (; c < numChannels; c++) {
+                max = scores[c] > max ? scores[c] : max;
+            }
+            classMap[p] = FirstIndexOf(scores, numChannels, max);
+        }
+        return;
+    }
+#endif
+    for (size_t p = 0; p < numPixels; p++, scores += numChannels) {
+        classMap[p] = ArgmaxPixel(scores, numChannels);
+    }
+}
+
+size_t RunLengthEncode(const uint8_t* classMap, size_t size, vector<int32_t>& runs) {
+    size_t numRuns = 0;
+    size_t i = 0;
+    while (i < size) {
+        const uint8_t value = classMap[i];
+        size_t end = i + 1;
+        while (end < size && classMap[end] == value) {
+            end++;
+        }
+        runs.push_back(value);
+        runs.push_back(static_cast<int32_t>(end - i));
+        numRuns++;
+        i = end;
+    }
+    return numRuns;
+}
+}  // namespace acap_runtime
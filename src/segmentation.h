@@ -0,0 +1,54 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SEGMENTATION_H
+#define SEGMENTATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace acap_runtime {
+
+// Largest number of classes that fits in a class map
+const size_t MAX_NBR_CLASSES = 256;
+
+/**
+ * @brief Per-pixel argmax over the channels of an interleaved tensor
+ *
+ * Reads numPixels * numChannels scores laid out as [pixel][channel] and
+ * writes the index of the highest scoring channel of each pixel to classMap.
+ * Ties resolve to the lowest channel index. numChannels must be in the range
+ * 1 to MAX_NBR_CLASSES.
+ */
+void ArgmaxChannels(const uint8_t* scores,
+                    size_t numPixels,
+                    size_t numChannels,
+                    uint8_t* classMap);
+void ArgmaxChannels(const int8_t* scores, size_t numPixels, size_t numChannels, uint8_t* classMap);
+void ArgmaxChannels(const float* scores, size_t numPixels, size_t numChannels, uint8_t* classMap);
+
+/**
+ * @brief Run-length encode a class map
+ *
+ * Appends one (class, length) pair per run of equal values to runs.
+ *
+ * @return Number of runs
+ */
+size_t RunLengthEncode(const uint8_t* classMap, size_t size, std::vector<int32_t>& runs);
+}  // namespace acap_runtime
+
+#endif
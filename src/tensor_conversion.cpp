@@ -0,0 +1,505 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensor_conversion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#if defined(__aarch64__) || (defined(__ARM_FP) && (__ARM_FP & 2))
+#define USE_NEON_FP16
+#endif
+#elif defined(__F16C__)
+#include <immintrin.h>
+#define USE_F16C
+#endif
+
+using namespace std;
+using namespace tensorflow;
+
+namespace acap_runtime {
+
+// Scalar narrowing of the values left after the vectorized part
+template <typename T>
+static inline void NarrowTail(const int32_t* values, size_t i, size_t count, T* out) {
+    for (; i < count; i++) {
+        out[i] = static_cast<T>(values[i]);
+    }
+}
+
+void NarrowInt32(const int32_t* values, size_t count, uint8_t* out) {
+    size_t i = 0;
+#ifdef USE_NEON
+    for (; i + 16 <= count; i += 16) {
+        const int16x8_t low = vcombine_s16(vmovn_s32(vld1q_s32(values + i)),
+                                           vmovn_s32(vld1q_s32(values + i + 4)));
+        const int16x8_t high = vcombine_s16(vmovn_s32(vld1q_s32(values + i + 8)),
+                                            vmovn_s32(vld1q_s32(values + i + 12)));
+        vst1q_u8(out + i, vreinterpretq_u8_s8(vcombine_s8(vmovn_s16(low), vmovn_s16(high))));
+    }
+#endif
+    NarrowTail(values, i, count, out);
+}
+
+void NarrowInt32(const int32_t* values, size_t count, int8_t* out) {
+    NarrowInt32(values, count, reinterpret_cast<uint8_t*>(out));
+}
+
+void NarrowInt32(const int32_t* values, size_t count, uint16_t* out) {
+    size_t i = 0;
+#ifdef USE_NEON
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t narrowed = vcombine_s16(vmovn_s32(vld1q_s32(values + i)),
+                                                vmovn_s32(vld1q_s32(values + i + 4)));
+        vst1q_u16(out + i, vreinterpretq_u16_s16(narrowed));
+    }
+#endif
+    NarrowTail(values, i, count, out);
+}
+
+void NarrowInt32(const int32_t* values, size_t count, int16_t* out) {
+    NarrowInt32(values, count, reinterpret_cast<uint16_t*>(out));
+}
+
+// Scalar conversion to half precision, rounding to nearest even
+static inline uint16_t FloatToHalf(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7fffffff;
+
+    // Infinity and NaN, keeping NaN quiet
+    if (bits >= 0x7f800000) {
+        return sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 | ((bits >> 13) & 0x3ff) : 0);
+    }
+    // Values rounding to above 65504 overflow to infinity
+    if (bits >= 0x477ff000) {
+        return sign | 0x7c00;
+    }
+    // Values below 2^-14 are subnormal, and below 2^-25 zero
+    if (bits < 0x38800000) {
+        if (bits < 0x33000000) {
+            return sign;
+        }
+        const uint32_t mantissa = (bits & 0x7fffff) | 0x800000;
+        const uint32_t shift = 126 - (bits >> 23);
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return sign | half;
+    }
+
+    // Rebias the exponent, a carry from rounding rolls over into it
+    uint32_t half = (bits - 0x38000000) >> 13;
+    const uint32_t rest = bits & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return sign | half;
+}
+
+// Scalar conversion from half precision, which is exact
+static inline float HalfToFloat(const uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if (0x1f == exponent) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (0 != exponent) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (0 == mantissa) {
+        bits = sign;
+    } else {
+        // Normalize subnormal values
+        exponent = 113;
+        while (0 == (mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void FloatToHalf(const float* values, size_t count, uint16_t* out) {
+    size_t i = 0;
+#if defined(USE_NEON_FP16)
+    for (; i + 4 <= count; i += 4) {
+        vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(values + i))));
+    }
+#elif defined(USE_F16C)
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = FloatToHalf(values[i]);
+    }
+}
+
+void HalfToFloat(const uint16_t* values, size_t count, float* out) {
+    size_t i = 0;
+#if defined(USE_NEON_FP16)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(values + i))));
+    }
+#elif defined(USE_F16C)
+    for (; i + 8 <= count; i += 8) {
+        const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(halves));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = HalfToFloat(values[i]);
+    }
+}
+
+void NormalizeFloat(const float* values,
+                    size_t count,
+                    const InputTransform& transform,
+                    float* out) {
+    // As a multiply-add, (value - mean) / std = value * a + b
+    const float a = 1 / transform.std;
+    const float b = -transform.mean / transform.std;
+    size_t i = 0;
+#ifdef USE_NEON
+    const float32x4_t vb = vdupq_n_f32(b);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i, vmlaq_n_f32(vb, vld1q_f32(values + i), a));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = values[i] * a + b;
+    }
+}
+
+#ifdef USE_NEON
+// Quantize 8 values to 16-bit integers, rounding half away from zero
+// before the zero point is added
+static inline int16x8_t Quantize8(const float* values,
+                                  const float a,
+                                  const float32x4_t b,
+                                  const int16x8_t zeroPoint) {
+    const float32x4_t low = vmlaq_n_f32(b, vld1q_f32(values), a);
+    const float32x4_t high = vmlaq_n_f32(b, vld1q_f32(values + 4), a);
+#ifdef __aarch64__
+    const int16x8_t rounded =
+        vcombine_s16(vqmovn_s32(vcvtaq_s32_f32(low)), vqmovn_s32(vcvtaq_s32_f32(high)));
+#else
+    // Add a half with the sign of the value and truncate
+    const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+    const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    const float32x4_t lowHalf =
+        vreinterpretq_f32_u32(vorrq_u32(half, vandq_u32(vreinterpretq_u32_f32(low), signMask)));
+    const float32x4_t highHalf =
+        vreinterpretq_f32_u32(vorrq_u32(half, vandq_u32(vreinterpretq_u32_f32(high), signMask)));
+    const int16x8_t rounded = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(vaddq_f32(low, lowHalf))),
+                                           vqmovn_s32(vcvtq_s32_f32(vaddq_f32(high, highHalf))));
+#endif
+    return vqaddq_s16(rounded, zeroPoint);
+}
+
+static inline void Store16(uint8_t* out, const int16x8_t low, const int16x8_t high) {
+    vst1q_u8(out, vcombine_u8(vqmovun_s16(low), vqmovun_s16(high)));
+}
+
+static inline void Store16(int8_t* out, const int16x8_t low, const int16x8_t high) {
+    vst1q_s8(out, vcombine_s8(vqmovn_s16(low), vqmovn_s16(high)));
+}
+#endif
+
+template <typename T>
+static void Quantize(const float* values, size_t count, const InputTransform& transform, T* out) {
+    // As a multiply-add, (value - mean) / std / scale = value * a + b
+    const float a = 1 / (transform.std * transform.scale);
+    const float b = -transform.mean * a;
+    size_t i = 0;
+#ifdef USE_NEON
+    const float32x4_t vb = vdupq_n_f32(b);
+    const int16x8_t zeroPoint = vdupq_n_s16(transform.zeroPoint);
+    for (; i + 16 <= count; i += 16) {
+        Store16(out + i,
+                Quantize8(values + i, a, vb, zeroPoint),
+                Quantize8(values + i + 8, a, vb, zeroPoint));
+    }
+#endif
+    const float low = numeric_limits<T>::min();
+    const float high = numeric_limits<T>::max();
+    for (; i < count; i++) {
+        const float quantized = round(values[i] * a + b) + transform.zeroPoint;
+        out[i] = static_cast<T>(min(max(quantized, low), high));
+    }
+}
+
+void QuantizeFloat(const float* values,
+                   size_t count,
+                   const InputTransform& transform,
+                   uint8_t* out) {
+    Quantize(values, count, transform, out);
+}
+
+void QuantizeFloat(const float* values,
+                   size_t count,
+                   const InputTransform& transform,
+                   int8_t* out) {
+    Quantize(values, count, transform, out);
+}
+
+// Transpose a matrix of rows x cols elements in blocks that fit in the cache,
+// so that neither the reads nor the writes stride through all of memory
+template <typename T>
+static void Transpose(const T* in, size_t rows, size_t cols, T* out) {
+    const size_t block = 64;
+    for (size_t row = 0; row < rows; row += block) {
+        const size_t rowEnd = min(row + block, rows);
+        for (size_t col = 0; col < cols; col += block) {
+            const size_t colEnd = min(col + block, cols);
+            for (size_t r = row; r < rowEnd; r++) {
+                for (size_t c = col; c < colEnd; c++) {
+                    out[c * rows + r] = in[r * cols + c];
+                }
+            }
+        }
+    }
+}
+
+// Deinterleave RGB pixels, the most common case, with structured loads
+template <typename T>
+static void DeinterleaveRgb(const T* in, size_t pixels, T* out) {
+    size_t i = 0;
+#ifdef USE_NEON
+    if (1 == sizeof(T)) {
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(in);
+        uint8_t* dst = reinterpret_cast<uint8_t*>(out);
+        for (; i + 16 <= pixels; i += 16) {
+            const uint8x16x3_t rgb = vld3q_u8(src + 3 * i);
+            vst1q_u8(dst + i, rgb.val[0]);
+            vst1q_u8(dst + pixels + i, rgb.val[1]);
+            vst1q_u8(dst + 2 * pixels + i, rgb.val[2]);
+        }
+    } else if (4 == sizeof(T)) {
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(in);
+        uint32_t* dst = reinterpret_cast<uint32_t*>(out);
+        for (; i + 4 <= pixels; i += 4) {
+            const uint32x4x3_t rgb = vld3q_u32(src + 3 * i);
+            vst1q_u32(dst + i, rgb.val[0]);
+            vst1q_u32(dst + pixels + i, rgb.val[1]);
+            vst1q_u32(dst + 2 * pixels + i, rgb.val[2]);
+        }
+    }
+#endif
+    for (; i < pixels; i++) {
+        out[i] = in[3 * i];
+        out[pixels + i] = in[3 * i + 1];
+        out[2 * pixels + i] = in[3 * i + 2];
+    }
+}
+
+// Interleave RGB planes with structured stores
+template <typename T>
+static void InterleaveRgb(const T* in, size_t pixels, T* out) {
+    size_t i = 0;
+#ifdef USE_NEON
+    if (1 == sizeof(T)) {
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(in);
+        uint8_t* dst = reinterpret_cast<uint8_t*>(out);
+        for (; i + 16 <= pixels; i += 16) {
+            uint8x16x3_t rgb;
+            rgb.val[0] = vld1q_u8(src + i);
+            rgb.val[1] = vld1q_u8(src + pixels + i);
+            rgb.val[2] = vld1q_u8(src + 2 * pixels + i);
+            vst3q_u8(dst + 3 * i, rgb);
+        }
+    } else if (4 == sizeof(T)) {
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(in);
+        uint32_t* dst = reinterpret_cast<uint32_t*>(out);
+        for (; i + 4 <= pixels; i += 4) {
+            uint32x4x3_t rgb;
+            rgb.val[0] = vld1q_u32(src + i);
+            rgb.val[1] = vld1q_u32(src + pixels + i);
+            rgb.val[2] = vld1q_u32(src + 2 * pixels + i);
+            vst3q_u32(dst + 3 * i, rgb);
+        }
+    }
+#endif
+    for (; i < pixels; i++) {
+        out[3 * i] = in[i];
+        out[3 * i + 1] = in[pixels + i];
+        out[3 * i + 2] = in[2 * pixels + i];
+    }
+}
+
+template <typename T>
+static void InterleavedToPlanar(const T* in, size_t pixels, size_t channels, T* out) {
+    if (3 == channels) {
+        DeinterleaveRgb(in, pixels, out);
+    } else {
+        Transpose(in, pixels, channels, out);
+    }
+}
+
+template <typename T>
+static void PlanarToInterleaved(const T* in, size_t pixels, size_t channels, T* out) {
+    if (3 == channels) {
+        InterleaveRgb(in, pixels, out);
+    } else {
+        Transpose(in, channels, pixels, out);
+    }
+}
+
+bool InterleavedToPlanar(const void* in,
+                         size_t pixels,
+                         size_t channels,
+                         size_t elementSize,
+                         void* out) {
+    switch (elementSize) {
+        case 1:
+            InterleavedToPlanar(static_cast<const uint8_t*>(in),
+                                pixels,
+                                channels,
+                                static_cast<uint8_t*>(out));
+            return true;
+        case 2:
+            InterleavedToPlanar(static_cast<const uint16_t*>(in),
+                                pixels,
+                                channels,
+                                static_cast<uint16_t*>(out));
+            return true;
+        case 4:
+            InterleavedToPlanar(static_cast<const uint32_t*>(in),
+                                pixels,
+                                channels,
+                                static_cast<uint32_t*>(out));
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool PlanarToInterleaved(const void* in,
+                         size_t pixels,
+                         size_t channels,
+                         size_t elementSize,
+                         void* out) {
+    switch (elementSize) {
+        case 1:
+            PlanarToInterleaved(static_cast<const uint8_t*>(in),
+                                pixels,
+                                channels,
+                                static_cast<uint8_t*>(out));
+            return true;
+        case 2:
+            PlanarToInterleaved(static_cast<const uint16_t*>(in),
+                                pixels,
+                                channels,
+                                static_cast<uint16_t*>(out));
+            return true;
+        case 4:
+            PlanarToInterleaved(static_cast<const uint32_t*>(in),
+                                pixels,
+                                channels,
+                                static_cast<uint32_t*>(out));
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Values of the same type are copied as is
+template <typename T>
+static inline void Convert(const T* values, size_t count, T* out) {
+    memcpy(out, values, count * sizeof(T));
+}
+
+template <typename T, typename V>
+static inline void Convert(const V* values, size_t count, T* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<T>(values[i]);
+    }
+}
+
+static inline void Convert(const int32_t* values, size_t count, uint8_t* out) {
+    NarrowInt32(values, count, out);
+}
+
+static inline void Convert(const int32_t* values, size_t count, int8_t* out) {
+    NarrowInt32(values, count, out);
+}
+
+static inline void Convert(const int32_t* values, size_t count, uint16_t* out) {
+    NarrowInt32(values, count, out);
+}
+
+static inline void Convert(const int32_t* values, size_t count, int16_t* out) {
+    NarrowInt32(values, count, out);
+}
+
+// Pack a repeated field as values of type T, repeating the last value
+template <typename T, typename Field>
+static bool PackField(const Field& field, size_t numElements, string& buffer) {
+    const size_t count = field.size();
+    if (count > numElements) {
+        return false;
+    }
+    buffer.resize(numElements * sizeof(T));
+    T* out = reinterpret_cast<T*>(&buffer[0]);
+    Convert(field.data(), count, out);
+    fill(out + count, out + numElements, 0 < count ? out[count - 1] : T());
+    return true;
+}
+
+bool PackTensorValues(const TensorProto& tensor, size_t numElements, string& buffer) {
+    switch (tensor.dtype()) {
+        case DataType::DT_FLOAT:
+            return PackField<float>(tensor.float_val(), numElements, buffer);
+        case DataType::DT_DOUBLE:
+            return PackField<double>(tensor.double_val(), numElements, buffer);
+        case DataType::DT_INT32:
+            return PackField<int32_t>(tensor.int_val(), numElements, buffer);
+        case DataType::DT_UINT8:
+            return PackField<uint8_t>(tensor.int_val(), numElements, buffer);
+        case DataType::DT_INT8:
+            return PackField<int8_t>(tensor.int_val(), numElements, buffer);
+        case DataType::DT_UINT16:
+            return PackField<uint16_t>(tensor.int_val(), numElements, buffer);
+        case DataType::DT_INT16:
+            return PackField<int16_t>(tensor.int_val(), numElements, buffer);
+        case DataType::DT_HALF:
+            return PackField<uint16_t>(tensor.half_val(), numElements, buffer);
+        case DataType::DT_INT64:
+            return PackField<int64_t>(tensor.int64_val(), numElements, buffer);
+        case DataType::DT_UINT32:
+            return PackField<uint32_t>(tensor.uint32_val(), numElements, buffer);
+        case DataType::DT_UINT64:
+            return PackField<uint64_t>(tensor.uint64_val(), numElements, buffer);
+        case DataType::DT_BOOL:
+            return PackField<bool>(tensor.bool_val(), numElements, buffer);
+        default:
+            return false;
+    }
+}
+}  // namespace acap_runtime
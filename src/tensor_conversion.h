@@ -0,0 +1,120 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TENSOR_CONVERSION_H
+#define TENSOR_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tensorflow/core/framework/tensor.pb.h"
+
+namespace acap_runtime {
+
+// Transform of single precision input values before they are given to a model
+struct InputTransform {
+    // Normalization, (value - mean) / std
+    float mean = 0;
+    float std = 1;
+    // Quantization of normalized values for 8-bit model inputs,
+    // round(value / scale) + zeroPoint. A scale of 0 disables quantization.
+    float scale = 0;
+    int32_t zeroPoint = 0;
+};
+
+/**
+ * @brief Narrow 32-bit integers to a smaller integer type
+ *
+ * Values are truncated to the width of the output type, as by a cast. This is
+ * how 8 and 16-bit values are stored in the int_val and half_val fields of a
+ * TensorProto.
+ */
+void NarrowInt32(const int32_t* values, size_t count, uint8_t* out);
+void NarrowInt32(const int32_t* values, size_t count, int8_t* out);
+void NarrowInt32(const int32_t* values, size_t count, uint16_t* out);
+void NarrowInt32(const int32_t* values, size_t count, int16_t* out);
+
+/**
+ * @brief Convert between single and half precision floats
+ *
+ * Half precision values are IEEE 754 binary16 bit patterns. Conversion to
+ * half precision rounds to nearest even, and values too large for half
+ * precision become infinity.
+ */
+void FloatToHalf(const float* values, size_t count, uint16_t* out);
+void HalfToFloat(const uint16_t* values, size_t count, float* out);
+
+/**
+ * @brief Normalize single precision values
+ */
+void NormalizeFloat(const float* values,
+                    size_t count,
+                    const InputTransform& transform,
+                    float* out);
+
+/**
+ * @brief Normalize and quantize single precision values to 8-bit integers
+ *
+ * Values are rounded half away from zero, as by TensorFlow Lite, and
+ * saturated to the range of the output type.
+ */
+void QuantizeFloat(const float* values,
+                   size_t count,
+                   const InputTransform& transform,
+                   uint8_t* out);
+void QuantizeFloat(const float* values, size_t count, const InputTransform& transform, int8_t* out);
+
+/**
+ * @brief Transpose interleaved pixels, HWC, to one plane per channel, CHW
+ *
+ * Elements of 1, 2 or 4 bytes are supported, e.g. uint8, half or float.
+ * Returns false for other element sizes.
+ */
+bool InterleavedToPlanar(const void* in,
+                         size_t pixels,
+                         size_t channels,
+                         size_t elementSize,
+                         void* out);
+
+/**
+ * @brief Transpose planes, CHW, to interleaved pixels, HWC
+ */
+bool PlanarToInterleaved(const void* in,
+                         size_t pixels,
+                         size_t channels,
+                         size_t elementSize,
+                         void* out);
+
+/**
+ * @brief Pack the repeated field values of a tensor into contiguous memory
+ *
+ * Reads the field matching the dtype of the tensor, i.e. float_val,
+ * double_val, int_val, int64_val, uint32_val, uint64_val, bool_val or
+ * half_val, and writes numElements values of the dtype to buffer. As in
+ * TensorFlow, a field with fewer values than numElements has its last value
+ * repeated, so that a single value is broadcast to the whole tensor, and an
+ * empty field gives zeros.
+ *
+ * @return False if the dtype is not supported or there are more values than
+ *         numElements
+ */
+bool PackTensorValues(const tensorflow::TensorProto& tensor,
+                      size_t numElements,
+                      std::string& buffer);
+}  // namespace acap_runtime
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tiling.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace acap_runtime {
+
+// Start positions of tiles along one axis
+static vector<int> TilePositions(int imageSize, int tileSize, int overlap) {
+    if (tileSize >= imageSize) {
+        return {0};
+    }
+
+    // Number of tiles needed to cover the image with the requested overlap
+    const int step = max(tileSize - overlap, 2);
+    const int numTiles = 1 + (imageSize - tileSize + step - 1) / step;
+
+    vector<int> positions;
+    for (int i = 0; i < numTiles; i++) {
+        int position = static_cast<int>((static_cast<long>(imageSize - tileSize) * i) /
+                                        (numTiles - 1));
+        positions.push_back(position & ~1);
+    }
+    return positions;
+}
+
+vector<Tile> ComputeTiles(int imageWidth,
+                          int imageHeight,
+                          int tileWidth,
+                          int tileHeight,
+                          int overlap) {
+    const int width = min(tileWidth, imageWidth) & ~1;
+    const int height = min(tileHeight, imageHeight) & ~1;
+
+    vector<Tile> tiles;
+    for (int y : TilePositions(imageHeight, height, overlap)) {
+        for (int x : TilePositions(imageWidth, width, overlap)) {
+            tiles.push_back(Tile{x, y, width, height});
+        }
+    }
+    return tiles;
+}
+
+Detection TileToImage(const Detection& detection,
+                      const Tile& tile,
+                      int imageWidth,
+                      int imageHeight) {
+    const float scaleX = static_cast<float>(tile.width) / imageWidth;
+    const float scaleY = static_cast<float>(tile.height) / imageHeight;
+    const float offsetX = static_cast<float>(tile.x) / imageWidth;
+    const float offsetY = static_cast<float>(tile.y) / imageHeight;
+    return Detection{offsetY + detection.ymin * scaleY,
+                     offsetX + detection.xmin * scaleX,
+                     offsetY + detection.ymax * scaleY,
+                     offsetX + detection.xmax * scaleX,
+                     detection.classId,
+                     detection.score};
+}
+
+// Intersection area relative to the area of the smaller box
+static float IntersectionOverSmaller(const Detection& a, const Detection& b) {
+    const float height = min(a.ymax, b.ymax) - max(a.ymin, b.ymin);
+    const float width = min(a.xmax, b.xmax) - max(a.xmin, b.xmin);
+    if (height <= 0 || width <= 0) {
+        return 0;
+    }
+    const float areaA = (a.ymax - a.ymin) * (a.xmax - a.xmin);
+    const float areaB = (b.ymax - b.ymin) * (b.xmax - b.xmin);
+    const float smaller = min(areaA, areaB);
+    return smaller > 0 ? height * width / smaller : 0;
+}
+
+vector<Detection> MergeDetections(vector<Detection> detections, float threshold) {
+    sort(detections.begin(), detections.end(), [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+
+    vector<Detection> merged;
+    vector<bool> absorbed(detections.size(), false);
+    for (size_t i = 0; i < detections.size(); i++) {
+        if (absorbed[i]) {
+            continue;
+        }
+        Detection result = detections[i];
+        for (size_t j = i + 1; j < detections.size(); j++) {
+            const Detection& other = detections[j];
+            if (absorbed[j] || other.classId != result.classId ||
+                IntersectionOverSmaller(result, other) <= threshold) {
+                continue;
+            }
+            result.ymin = min(result.ymin, other.ymin);
+            result.xmin = min(result.xmin, other.xmin);
+            result.ymax = max(result.ymax, other.ymax);
+            result.xmax = max(result.xmax, other.xmax);
+            absorbed[j] = true;
+        }
+        merged.push_back(result);
+    }
+    return merged;
+}
+}  // namespace acap_runtime
@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TILING_H
+#define TILING_H
+
+#include <cstddef>
+#include <vector>
+
+namespace acap_runtime {
+
+// Max number of tiles of an image, each tile is a full inference
+const size_t MAX_TILES = 256;
+
+struct Tile {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Bounding box in coordinates normalized to [0, 1], as output by
+// TFLite_Detection_PostProcess
+struct Detection {
+    float ymin;
+    float xmin;
+    float ymax;
+    float xmax;
+    float classId;
+    float score;
+};
+
+/**
+ * @brief Split an image into overlapping tiles
+ *
+ * Tiles have the given size, or the image size if that is smaller, and are
+ * spread evenly so that the first and last tile of each row and column are
+ * aligned to the image borders. Adjacent tiles overlap by at least overlap
+ * pixels. All coordinates and sizes are even, as required by NV12 crops.
+ */
+std::vector<Tile> ComputeTiles(int imageWidth,
+                               int imageHeight,
+                               int tileWidth,
+                               int tileHeight,
+                               int overlap);
+
+/**
+ * @brief Map a detection from tile coordinates to image coordinates
+ */
+Detection TileToImage(const Detection& detection,
+                      const Tile& tile,
+                      int imageWidth,
+                      int imageHeight);
+
+/**
+ * @brief Merge detections of the same object found in several tiles
+ *
+ * Detections are visited in order of decreasing score. A detection absorbs
+ * all remaining detections of the same class whose intersection covers more
+ * than threshold of the smaller box, growing to the union of their boxes.
+ * This joins objects split across tile borders as well as duplicates found
+ * in overlapping areas.
+ */
+std::vector<Detection> MergeDetections(std::vector<Detection> detections, float threshold);
+}  // namespace acap_runtime
+
+#endif
@@ -15,6 +15,7 @@
  */
 
 #include "video_capture.h"
+#include "metrics.h"
 
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -24,7 +25,11 @@
 #include <vdo-map.h>
 #include <vdo-types.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <sstream>
+#include <thread>
 
 using namespace grpc;
 using namespace std;
@@ -37,217 +42,752 @@ using namespace videocapture::v1;
 
 namespace acap_runtime {
 
+// Frames queued for a slow GetFrames subscriber with SKIP_POLICY_QUEUE
+const uint32_t DEFAULT_MAX_QUEUED_FRAMES = 8;
+
+// Frames kept for the consumers of a shared stream
+const size_t MAX_SHARED_FRAMES = 4;
+
+// Metrics of the capture service, looked up once since many are updated with
+// a lock held
+static Metric& vdoStreamsMetric = Metrics::Register("capture.vdo_streams");
+static Metric& skippedFramesMetric = Metrics::Register("capture.skipped_frames");
+static Metric& prefetchedFramesMetric = Metrics::Register("capture.prefetched_frames");
+static Metric& subscribersMetric = Metrics::Register("capture.subscribers");
+static Metric& droppedFramesMetric = Metrics::Register("capture.dropped_frames");
+static Metric& evictedFramesMetric = Metrics::Register("capture.evicted_frames");
+static Metric& savedFrameMissesMetric = Metrics::Register("capture.saved_frame_misses");
+static Metric& inferenceFramesMetric = Metrics::Register("capture.inference_frames");
+static Metric& frameAgeMetric = Metrics::Register("capture.frame_age_ms");
+static Metric& maxFrameAgeMetric = Metrics::Register("capture.max_frame_age_ms");
+
+// Upper bound of the size of a frame, for the memory budget of saved frames.
+// Encoded frames are assumed to be no larger than YUV frames.
+static uint64_t EstimateFrameSize(const StreamSettings& settings) {
+    const uint64_t pixels = static_cast<uint64_t>(settings.width()) * settings.height();
+    switch (settings.format()) {
+        case StreamFormat::VDO_FORMAT_RGB:
+        case StreamFormat::VDO_FORMAT_PLANAR_RGB:
+            return 3 * pixels;
+        default:
+            return 3 * pixels / 2;
+    }
+}
+
+// Frame references start at 1 and skip 0 when they wrap around
+static uint32_t NextFrameRef(const uint32_t frameRef) {
+    return 0 == frameRef + 1 ? 1 : frameRef + 1;
+}
+
+// Report the time from the capture of a frame until it is used for inference.
+// VDO timestamps are monotonic capture times in microseconds.
+static void ReportFrameAge(VdoFrame* frame) {
+    const gint64 age = g_get_monotonic_time() - static_cast<gint64>(vdo_frame_get_timestamp(frame));
+    const double ms = max<gint64>(0, age) / 1000.0;
+    inferenceFramesMetric.Add();
+    frameAgeMetric.Add(ms);
+    maxFrameAgeMetric.SetMax(ms);
+}
+
+// Streams with the same key share a VDO stream
+static string StreamKey(const StreamSettings& settings) {
+    stringstream key;
+    key << settings.format() << ' ' << settings.width() << 'x' << settings.height() << ' '
+        << settings.framerate();
+    return key.str();
+}
+
+SharedFrame::SharedFrame(VdoStream* stream, VdoBuffer* buffer)
+    : vdo_stream(stream), vdo_buffer(buffer) {
+    g_object_ref(vdo_stream);
+}
+
+SharedFrame::~SharedFrame() {
+    if (!vdo_stream_buffer_unref(vdo_stream, &vdo_buffer, nullptr)) {
+        ERRORLOG << "Unreferencing buffer failed" << endl;
+    }
+    g_object_unref(vdo_stream);
+}
+
+SharedStream::SharedStream(VdoStream* stream, const string& key)
+    : vdo_stream(stream), key(key) {}
+
+// Frames are given back before the stream is released
+SharedStream::~SharedStream() {
+    Stop();
+    if (_prefetch.joinable()) {
+        _prefetch.join();
+    }
+    _frames.clear();
+    g_object_unref(vdo_stream);
+}
+
+uint64_t SharedStream::AddCursor(const bool latest) {
+    scoped_lock lock(_mutex);
+    _cursors[_nextCursor] = Cursor{_firstFrame + _frames.size(), latest};
+    return _nextCursor++;
+}
+
+void SharedStream::RemoveCursor(const uint64_t cursor) {
+    scoped_lock lock(_mutex);
+    _cursors.erase(cursor);
+    Trim();
+}
+
+// Only one consumer at a time takes a frame from VDO, the others wait for it
+// instead of taking frames of their own. While prefetching, all consumers
+// wait for the prefetch thread.
+shared_ptr<SharedFrame> SharedStream::NextFrame(const uint64_t cursor, GError** error) {
+    unique_lock lock(_mutex);
+    while (true) {
+        auto next = _cursors.find(cursor);
+        if (_cursors.end() == next) {
+            return nullptr;
+        }
+
+        // Frames that left the ring before they were read are skipped
+        const uint64_t end = _firstFrame + _frames.size();
+        next->second.next = max(next->second.next, _firstFrame);
+        if (next->second.next < end) {
+            if (next->second.latest) {
+                next->second.next = end - 1;
+            }
+            shared_ptr<SharedFrame> frame = _frames[next->second.next++ - _firstFrame];
+            Trim();
+            return frame;
+        }
+        if (!_fetching && !_prefetching) {
+            break;
+        }
+        _fetched.wait(lock);
+    }
+
+    _fetching = true;
+    lock.unlock();
+    VdoBuffer* buffer = vdo_stream_get_buffer(vdo_stream, error);
+    lock.lock();
+    _fetching = false;
+    _fetched.notify_all();
+    if (nullptr == buffer) {
+        return nullptr;
+    }
+
+    auto frame = make_shared<SharedFrame>(vdo_stream, buffer);
+    _frames.push_back(frame);
+    auto next = _cursors.find(cursor);
+    if (_cursors.end() != next) {
+        next->second.next = _firstFrame + _frames.size();
+    }
+    Trim();
+    return frame;
+}
+
+void SharedStream::StartPrefetch() {
+    scoped_lock lock(_mutex);
+    if (!_prefetch.joinable()) {
+        _prefetching = true;
+        _prefetch = thread(&SharedStream::Prefetch, this);
+    }
+}
+
+// Consumers take frames themselves again if prefetching fails
+void SharedStream::Prefetch() {
+    GError* error = nullptr;
+    while (!_stopped) {
+        VdoBuffer* buffer = vdo_stream_get_buffer(vdo_stream, &error);
+        scoped_lock lock(_mutex);
+        if (nullptr == buffer) {
+            if (!_stopped) {
+                ERRORLOG << "Prefetching frame failed"
+                         << (nullptr != error ? string(" (") + error->message + ")" : "")
+                         << endl;
+            }
+            g_clear_error(&error);
+            break;
+        }
+        _frames.push_back(make_shared<SharedFrame>(vdo_stream, buffer));
+        prefetchedFramesMetric.Add();
+        Trim();
+        _fetched.notify_all();
+    }
+
+    scoped_lock lock(_mutex);
+    _prefetching = false;
+    _fetched.notify_all();
+}
+
+void SharedStream::Stop() {
+    if (!_stopped.exchange(true)) {
+        vdo_stream_stop(vdo_stream);
+    }
+}
+
+// Drop the frames that every consumer has read, and the oldest frames when
+// the ring is full. Consumers of the latest frame only need the newest one.
+// NB! Called with _mutex held
+void SharedStream::Trim() {
+    const uint64_t end = _firstFrame + _frames.size();
+    uint64_t oldest = end;  // Oldest frame that a consumer reads in order
+    uint64_t needed = end;  // Oldest frame that a consumer reads
+    for (auto& [id, cursor] : _cursors) {
+        if (cursor.latest) {
+            needed = min(needed, cursor.next < end ? end - 1 : end);
+        } else {
+            oldest = min(oldest, cursor.next);
+        }
+    }
+    needed = min(needed, oldest);
+    while (!_frames.empty() && (_firstFrame < needed || MAX_SHARED_FRAMES < _frames.size())) {
+        if (_firstFrame >= oldest) {
+            skippedFramesMetric.Add();
+        }
+        _frames.pop_front();
+        _firstFrame++;
+    }
+}
+
+/**
+ * Writes the frames of a stream to a GetFrames subscriber
+ *
+ * A thread reads frames with its own cursor at the rate of the stream and queues them,
+ * and each frame is written when the client has received the previous one.
+ * Frames that a slow client can not keep up with are dropped according to
+ * the skip policy, and the count is sent with every frame.
+ */
+class Capture::FrameWriter : public ServerWriteReactor {
+  public:
+    FrameWriter(Capture* capture,
+                shared_ptr<SharedStream> stream,
+                const GetFramesRequest& request)
+        : _capture(capture), _stream(move(stream)), _cursor(_stream->AddCursor()),
+          _policy(request.skip_policy()), _maxQueued(request.max_queued()),
+          _maxFrames(request.max_frames()) {
+        if (0 == _maxQueued) {
+            _maxQueued = DEFAULT_MAX_QUEUED_FRAMES;
+        }
+        subscribersMetric.Add();
+        _thread = thread(&FrameWriter::Produce, this);
+    }
+
+    void OnWriteDone(bool ok) override {
+        scoped_lock lock(_mutex);
+        _writing = false;
+        if (!ok) {
+            FinishLocked(Status::CANCELLED);
+        } else if (!_queue.empty()) {
+            WriteLocked(move(_queue.front()));
+            _queue.pop_front();
+        } else if (_finishing) {
+            FinishLocked(_finishStatus);
+        }
+    }
+
+    void OnCancel() override {
+        scoped_lock lock(_mutex);
+        FinishLocked(Status::CANCELLED);
+    }
+
+    void OnDone() override {
+        _stopping = true;
+        _thread.join();
+        _stream->RemoveCursor(_cursor);
+        subscribersMetric.Add(-1);
+        delete this;
+    }
+
+  private:
+    void Produce() {
+        uint32_t count = 0;
+        while (!_stopping) {
+            GetFrameResponse frame;
+            Status status = _capture->ReadFrame(*_stream, _cursor, &frame);
+            scoped_lock lock(_mutex);
+            if (!status.ok()) {
+                FinishLocked(status);
+                return;
+            }
+            Enqueue(move(frame));
+            if (0 < _maxFrames && ++count >= _maxFrames) {
+                FinishLocked(Status::OK);
+                return;
+            }
+        }
+    }
+
+    // NB! Called with _mutex held
+    void Enqueue(GetFrameResponse&& frame) {
+        if (_finishing) {
+            return;
+        }
+        if (!_writing) {
+            WriteLocked(move(frame));
+            return;
+        }
+        if (SkipPolicy::SKIP_POLICY_LATEST == _policy) {
+            Drop(_queue.size());
+            _queue.clear();
+        } else if (_queue.size() >= _maxQueued) {
+            Drop(1);
+            _queue.pop_front();
+        }
+        _queue.push_back(move(frame));
+    }
+
+    // NB! Called with _mutex held
+    void Drop(const size_t count) {
+        _dropped += count;
+        droppedFramesMetric.Add(count);
+    }
+
+    // The frame is kept until its write is done
+    // NB! Called with _mutex held
+    void WriteLocked(GetFrameResponse&& frame) {
+        _frame = move(frame);
+        _frame.set_dropped_frames(_dropped);
+        _writing = true;
+        StartWrite(&_frame);
+    }
+
+    // The call is finished when the write in progress is done. Queued frames
+    // are written first if the stream ended normally, otherwise dropped.
+    // NB! Called with _mutex held
+    void FinishLocked(const Status& status) {
+        _stopping = true;
+        if (!_finishing) {
+            _finishing = true;
+            _finishStatus = status;
+        }
+        if (!status.ok()) {
+            _queue.clear();
+        }
+        if (_finished || _writing || !_queue.empty()) {
+            return;
+        }
+        _finished = true;
+        Finish(_finishStatus);
+    }
+
+    Capture* _capture;
+    shared_ptr<SharedStream> _stream;
+    uint64_t _cursor;
+    SkipPolicy _policy;
+    uint32_t _maxQueued;
+    uint32_t _maxFrames;
+    thread _thread;
+    atomic<bool> _stopping{false};
+    mutex _mutex;
+    deque<GetFrameResponse> _queue;  // Guarded by _mutex
+    GetFrameResponse _frame;         // Being written, guarded by _mutex
+    bool _writing = false;           // Guarded by _mutex
+    bool _finishing = false;         // Guarded by _mutex
+    bool _finished = false;          // Guarded by _mutex
+    Status _finishStatus;            // Guarded by _mutex
+    uint64_t _dropped = 0;           // Guarded by _mutex
+};
+
 // Initialize the capture service
-Capture::Capture(const bool verbose) : _verbose(verbose) {
+Capture::Capture(const bool verbose, WorkerPool* workers, const CaptureSettings& settings)
+    : _verbose(verbose), _workers(workers), _settings(settings) {
     TRACELOG << "Init" << endl;
 }
 
-// Create a new stream
-Status Capture::NewStream(ServerContext* context,
+ServerUnaryReactor* Capture::NewStream(CallbackServerContext* context,
+                                       const NewStreamRequest* request,
+                                       NewStreamResponse* response) {
+    return Dispatch(_workers, context, [this, context, request, response] {
+        return NewStream(static_cast<ServerContextBase*>(context), request, response);
+    });
+}
+
+ServerUnaryReactor* Capture::DeleteStream(CallbackServerContext* context,
+                                          const DeleteStreamRequest* request,
+                                          DeleteStreamResponse* response) {
+    return Dispatch(_workers, context, [this, context, request, response] {
+        return DeleteStream(static_cast<ServerContextBase*>(context), request, response);
+    });
+}
+
+ServerUnaryReactor* Capture::GetFrame(CallbackServerContext* context,
+                                      const GetFrameRequest* request,
+                                      GetFrameResponse* response) {
+    return Dispatch(_workers, context, [this, context, request, response] {
+        return GetFrame(static_cast<ServerContextBase*>(context), request, response);
+    });
+}
+
+Capture::ServerWriteReactor* Capture::GetFrames(CallbackServerContext* context,
+                                                const GetFramesRequest* request) {
+    TRACELOG << "Streaming frames from stream " << request->stream_id() << endl;
+
+    scoped_lock lock(_mutex);
+    auto currentStream = _streams.find(request->stream_id());
+    if (currentStream == _streams.end()) {
+        // Finish at once with a reactor that writes nothing
+        class Failed : public ServerWriteReactor {
+          public:
+            explicit Failed(const Status& status) { Finish(status); }
+            void OnDone() override { delete this; }
+        };
+        return new Failed(OutputError("Getting frames failed. Stream not found",
+                                      StatusCode::FAILED_PRECONDITION));
+    }
+    return new FrameWriter(this, currentStream->second.shared, *request);
+}
+
+// Create a new stream, which shares the VDO stream of other streams with the
+// same settings
+Status Capture::NewStream(ServerContextBase* context,
                           const NewStreamRequest* request,
                           NewStreamResponse* response) {
-    TRACELOG << "Creating VDO stream" << endl;
-
     GError* error = nullptr;
     const StreamSettings& settings = request->settings();
+    const string key = StreamKey(settings);
 
-    VdoMap* settingsMap = vdo_map_new();
-    vdo_map_set_uint32(settingsMap, "format", settings.format());
-    vdo_map_set_uint32(settingsMap, "buffer.strategy", VDO_BUFFER_STRATEGY_INFINITE);
-    vdo_map_set_uint32(settingsMap, "width", settings.width());
-    vdo_map_set_uint32(settingsMap, "height", settings.height());
-    vdo_map_set_uint32(settingsMap, "framerate", settings.framerate());
-
-    VdoStream* stream = vdo_stream_new(settingsMap, nullptr, &error);
-    if (!stream) {
-        return OutputError("Stream creation failed", StatusCode::INTERNAL, error);
-    }
-    if (_verbose) {
-        PrintStreamInfo(stream);
+    scoped_lock lock(_mutex);
+    shared_ptr<SharedStream> shared = _shared[key].lock();
+    if (!shared) {
+        TRACELOG << "Creating VDO stream" << endl;
+
+        VdoMap* settingsMap = vdo_map_new();
+        vdo_map_set_uint32(settingsMap, "format", settings.format());
+        vdo_map_set_uint32(settingsMap, "buffer.strategy", VDO_BUFFER_STRATEGY_INFINITE);
+        vdo_map_set_uint32(settingsMap, "width", settings.width());
+        vdo_map_set_uint32(settingsMap, "height", settings.height());
+        vdo_map_set_uint32(settingsMap, "framerate", settings.framerate());
+
+        VdoStream* stream = vdo_stream_new(settingsMap, nullptr, &error);
+        g_object_unref(settingsMap);
+        if (!stream) {
+            _shared.erase(key);
+            return OutputError("Stream creation failed", StatusCode::INTERNAL, error);
+        }
+        if (_verbose) {
+            PrintStreamInfo(stream);
+        }
+        if (!vdo_stream_start(stream, &error)) {
+            g_object_unref(stream);
+            _shared.erase(key);
+            return OutputError("Starting stream failed", StatusCode::INTERNAL, error);
+        }
+        shared = make_shared<SharedStream>(stream, key);
+        _shared[key] = shared;
+        vdoStreamsMetric.Set(_shared.size());
+    } else {
+        TRACELOG << "Sharing VDO stream " << vdo_stream_get_id(shared->vdo_stream) << endl;
     }
 
-    unsigned int streamId = vdo_stream_get_id(stream);
-    _streams.emplace(streamId, Stream{stream, deque<Buffer>{}});
+    // Saved frames are bounded by the memory left of the budget
+    const uint64_t frameSize = EstimateFrameSize(settings);
+    uint32_t savedFrames =
+        max(1u, 0 < request->saved_frames() ? request->saved_frames() : _settings.savedFrames);
+    const uint64_t left =
+        _settings.savedFrameMemory > _savedMemory ? _settings.savedFrameMemory - _savedMemory : 0;
+    if (0 < frameSize && savedFrames > left / frameSize) {
+        savedFrames = max<uint64_t>(1, left / frameSize);
+        TRACELOG << "Saved frames limited to " << savedFrames << " by memory budget" << endl;
+    }
+    _savedMemory += savedFrames * frameSize;
 
-    if (!vdo_stream_start(stream, &error)) {
-        return OutputError("Starting stream failed", StatusCode::INTERNAL, error);
+    if (request->prefetch()) {
+        shared->StartPrefetch();
     }
 
+    const unsigned int streamId = _nextStreamId++;
+    shared->consumers++;
+    _streams.emplace(streamId,
+                     Stream{shared,
+                            shared->AddCursor(request->prefetch()),
+                            vector<Buffer>(savedFrames),
+                            0,
+                            savedFrames * frameSize});
+
     response->set_stream_id(streamId);
+    response->set_saved_frames(savedFrames);
 
     return Status::OK;
 }
 
-// Delete a stream
-Status Capture::DeleteStream(ServerContext* context,
+// Delete a stream, and its VDO stream when no other stream shares it
+Status Capture::DeleteStream(ServerContextBase* context,
                              const DeleteStreamRequest* request,
                              DeleteStreamResponse* response) {
-    TRACELOG << "Deleting VDO stream: " << request->stream_id() << endl;
+    TRACELOG << "Deleting stream: " << request->stream_id() << endl;
 
+    scoped_lock lock(_mutex);
     auto currentStream = _streams.find(request->stream_id());
     if (currentStream == _streams.end()) {
         return OutputError("Deleting stream failed: stream not found",
                            StatusCode::FAILED_PRECONDITION);
     }
 
-    VdoStream* stream = currentStream->second.vdo_stream;
-
+    // Subscribers of a stopped stream get no more frames, and the VDO stream
+    // is released with the last reference to it
+    Stream& stream = currentStream->second;
+    shared_ptr<SharedStream> shared = stream.shared;
+    shared->RemoveCursor(stream.cursor);
+    if (0 == --shared->consumers) {
+        TRACELOG << "Stopping VDO stream " << vdo_stream_get_id(shared->vdo_stream) << endl;
+        _shared.erase(shared->key);
+        shared->Stop();
+        vdoStreamsMetric.Set(_shared.size());
+    }
+    _savedMemory -= stream.savedMemory;
     _streams.erase(currentStream);
-    vdo_stream_stop(stream);
-    g_object_unref(stream);
 
     return Status::OK;
 }
 
 // Capture a frame from a specific stream, possibly from a previously saved
 // frame
-Status Capture::GetFrame(ServerContext* context,
+Status Capture::GetFrame(ServerContextBase* context,
                          const GetFrameRequest* request,
                          GetFrameResponse* response) {
-    GError* error = nullptr;
-
     TRACELOG << "Getting frame from stream " << request->stream_id() << endl;
 
-    auto currentStream = _streams.find(request->stream_id());
-    if (currentStream == _streams.end()) {
-        return OutputError("Getting frame failed. Stream not found",
-                           StatusCode::FAILED_PRECONDITION);
+    shared_ptr<SharedStream> shared;
+    uint64_t cursor;
+    {
+        scoped_lock lock(_mutex);
+        auto currentStream = _streams.find(request->stream_id());
+        if (currentStream == _streams.end()) {
+            return OutputError("Getting frame failed. Stream not found",
+                               StatusCode::FAILED_PRECONDITION);
+        }
+
+        uint32_t frameRef = request->frame_reference();
+        if (frameRef > 0) {
+            if (!GetDataFromSavedFrame(currentStream->second, frameRef, response)) {
+                return OutputError("Getting frame from previous inference call failed",
+                                   StatusCode::NOT_FOUND);
+            } else {
+                TRACELOG << "Getting frame " << frameRef << " from previous inference call"
+                         << endl;
+                return Status::OK;
+            }
+        }
+        shared = currentStream->second.shared;
+        cursor = currentStream->second.cursor;
     }
-    VdoStream* stream = currentStream->second.vdo_stream;
     if (_verbose) {
-        PrintStreamInfo(stream);
+        PrintStreamInfo(shared->vdo_stream);
     }
 
-    uint32_t frameRef = request->frame_reference();
-    if (frameRef > 0) {
-        if (!GetDataFromSavedFrame(currentStream->second, frameRef, response)) {
-            return OutputError("Getting frame from previous inference call failed",
-                               StatusCode::NOT_FOUND);
-        } else {
-            TRACELOG << "Getting frame " << frameRef << " from previous inference call" << endl;
-            return Status::OK;
-        }
-    }
+    return ReadFrame(*shared, cursor, response);
+}
 
-    VdoBuffer* buffer = vdo_stream_get_buffer(stream, &error);
-    if (buffer == nullptr) {
+// Read the next frame of a consumer of a stream into a response
+Status Capture::ReadFrame(SharedStream& stream, const uint64_t cursor, GetFrameResponse* response) {
+    GError* error = nullptr;
+    shared_ptr<SharedFrame> sharedFrame = stream.NextFrame(cursor, &error);
+    if (!sharedFrame) {
         return OutputError("Unable to get VDO buffer", StatusCode::INTERNAL, error);
     }
-    VdoFrame* frame = vdo_buffer_get_frame(buffer);
+    VdoFrame* frame = vdo_buffer_get_frame(sharedFrame->vdo_buffer);
     gsize size = vdo_frame_get_size(frame);
 
-    void* bufferData = vdo_buffer_get_data(buffer);
+    void* bufferData = vdo_buffer_get_data(sharedFrame->vdo_buffer);
     if (nullptr == bufferData) {
-        if (!(vdo_stream_buffer_unref(stream, &buffer, &error)))
-            ERRORLOG << "Unreferencing buffer failed" << endl;
         return OutputError("Getting buffer failed", StatusCode::INTERNAL);
     }
 
     response->set_data(bufferData, size);
+    SetFrameInfo(frame, response);
+
+    return Status::OK;
+}
+
+// Set everything but the data of a frame in a response
+void Capture::SetFrameInfo(VdoFrame* frame, GetFrameResponse* response) {
     response->set_timestamp(vdo_frame_get_timestamp(frame));
     response->set_custom_timestamp(vdo_frame_get_custom_timestamp(frame));
-    response->set_size(size);
+    response->set_size(vdo_frame_get_size(frame));
     response->set_type(GetTypeString(frame));
     response->set_sequence_nbr(vdo_frame_get_sequence_nbr(frame));
+}
+
+// A new frame is saved like the frames of inference calls, so that its buffer
+// is not reused by VDO until it is evicted by later frames. A stream that saves
+// a single frame would evict it by the next frame taken, possibly before the
+// client has read it, so its frames are not exported.
+Status Capture::ExportFrame(const GetFrameRequest* request, GetFrameResponse* response, int* fd) {
+    TRACELOG << "Exporting frame from stream " << request->stream_id() << endl;
+
+    uint32_t frameRef = request->frame_reference();
+    shared_ptr<SharedFrame> sharedFrame;
+    {
+        scoped_lock lock(_mutex);
+        auto currentStream = _streams.find(request->stream_id());
+        if (currentStream == _streams.end()) {
+            return OutputError("Exporting frame failed. Stream not found",
+                               StatusCode::FAILED_PRECONDITION);
+        }
+        if (2 > currentStream->second.buffers.size()) {
+            return OutputError("Exporting frame failed. Stream saves fewer than two frames",
+                               StatusCode::FAILED_PRECONDITION);
+        }
+        if (frameRef > 0) {
+            Buffer* saved = FindSavedFrame(currentStream->second, frameRef);
+            if (nullptr == saved) {
+                return OutputError("Exporting frame failed. Frame reference not found",
+                                   StatusCode::NOT_FOUND);
+            }
+            sharedFrame = saved->frame;
+        }
+    }
+    if (!sharedFrame) {
+        Status status = TakeFrame(request->stream_id(), sharedFrame, frameRef);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+    VdoBuffer* buffer = sharedFrame->vdo_buffer;
 
-    if (!(vdo_stream_buffer_unref(stream, &buffer, &error))) {
-        return OutputError("Unreferencing buffer failed", StatusCode::INTERNAL, error);
+    // The duplicate stays valid even if the frame is evicted before it is sent
+    *fd = fcntl(vdo_buffer_get_fd(buffer), F_DUPFD_CLOEXEC, 0);
+    if (0 > *fd) {
+        return OutputError("Duplicating buffer file descriptor failed", StatusCode::INTERNAL);
     }
+    response->set_frame_reference(frameRef);
+    response->set_offset(vdo_buffer_get_offset(buffer));
+    SetFrameInfo(vdo_buffer_get_frame(buffer), response);
 
     return Status::OK;
 }
 
 // Capture a frame from a specific stream
-bool Capture::GetImgDataFromStream(unsigned int stream,
-                                   void** data,
-                                   size_t& size,
-                                   uint32_t& frameRef) {
-    GError* error = nullptr;
-
+shared_ptr<SharedFrame> Capture::GetImgDataFromStream(unsigned int stream,
+                                                      void** data,
+                                                      size_t& size,
+                                                      uint32_t& frameRef) {
     TRACELOG << "Getting frame from stream " << stream << endl;
 
-    auto currentStream = _streams.find(stream);
-    if (currentStream == _streams.end()) {
-        ERRORLOG << "Stream " << stream << " not found" << endl;
-        return false;
+    shared_ptr<SharedFrame> sharedFrame;
+    if (!TakeFrame(stream, sharedFrame, frameRef).ok()) {
+        return nullptr;
     }
+    VdoFrame* frame = vdo_buffer_get_frame(sharedFrame->vdo_buffer);
+    size = vdo_frame_get_size(frame);
+    ReportFrameAge(frame);
 
-    VdoStream* vdoStream = currentStream->second.vdo_stream;
-    if (_verbose) {
-        PrintStreamInfo(vdoStream);
+    // The data stays valid as long as the frame is held
+    *data = vdo_buffer_get_data(sharedFrame->vdo_buffer);
+    if (nullptr == *data) {
+        ERRORLOG << "Getting data from buffer failed" << endl;
+        return nullptr;
     }
 
-    scoped_lock lock(_mutex);
+    return sharedFrame;
+}
 
-    MaybeDeleteOldestFrame(currentStream->second);
+// Take the next frame of a stream and save it. The frame is waited for
+// without _mutex, so that calls on other streams are not held up.
+Status Capture::TakeFrame(unsigned int stream,
+                          shared_ptr<SharedFrame>& frame,
+                          uint32_t& frameRef) {
+    GError* error = nullptr;
+    shared_ptr<SharedStream> shared;
+    uint64_t cursor;
+    {
+        scoped_lock lock(_mutex);
+        auto currentStream = _streams.find(stream);
+        if (currentStream == _streams.end()) {
+            return OutputError("Getting frame failed. Stream not found",
+                               StatusCode::FAILED_PRECONDITION);
+        }
+        shared = currentStream->second.shared;
+        cursor = currentStream->second.cursor;
+    }
+    if (_verbose) {
+        PrintStreamInfo(shared->vdo_stream);
+    }
 
-    VdoBuffer* buffer = vdo_stream_get_buffer(vdoStream, &error);
-    if (buffer == nullptr) {
-        ERRORLOG << "Unable to get VDO buffer. Stream: " << stream << endl;
-        return false;
+    frame = shared->NextFrame(cursor, &error);
+    if (!frame) {
+        return OutputError("Unable to get VDO buffer", StatusCode::INTERNAL, error);
     }
-    VdoFrame* frame = vdo_buffer_get_frame(buffer);
-    size = vdo_frame_get_size(frame);
 
-    void* bufferData = vdo_buffer_get_data(buffer);
-    if (nullptr == bufferData) {
-        if (!(vdo_stream_buffer_unref(vdoStream, &buffer, &error)))
-            ERRORLOG << "Unreferencing buffer failed" << endl;
-        return false;
+    scoped_lock lock(_mutex);
+    auto currentStream = _streams.find(stream);
+    if (currentStream == _streams.end()) {
+        return OutputError("Getting frame failed. Stream deleted",
+                           StatusCode::FAILED_PRECONDITION);
     }
+    frameRef = SaveFrame(
+        currentStream->second, frame, vdo_frame_get_size(vdo_buffer_get_frame(frame->vdo_buffer)));
+    return Status::OK;
+}
 
-    *data = bufferData;
+// Get the data of a frame saved by an earlier call to GetImgDataFromStream
+shared_ptr<SharedFrame> Capture::GetImgDataFromSavedFrame(unsigned int stream,
+                                                          uint32_t frameRef,
+                                                          void** data,
+                                                          size_t& size) {
+    TRACELOG << "Getting frame " << frameRef << " from stream " << stream << endl;
 
-    frameRef = SaveFrame(currentStream->second, buffer, size);
+    scoped_lock lock(_mutex);
+    auto currentStream = _streams.find(stream);
+    if (currentStream == _streams.end()) {
+        ERRORLOG << "Stream " << stream << " not found" << endl;
+        return nullptr;
+    }
 
-    return true;
-}
+    Buffer* buffer = FindSavedFrame(currentStream->second, frameRef);
+    if (nullptr == buffer) {
+        return nullptr;
+    }
 
-// Save a frame in memory so that a client can request it later
-uint32_t Capture::SaveFrame(Stream& stream, VdoBuffer* vdoBuffer, size_t size) {
-    // Increment frame reference by 1 or start at 1
-    uint32_t frameRef = stream.buffers.empty() ? 1 : stream.buffers.back().id + 1;
+    *data = vdo_buffer_get_data(buffer->frame->vdo_buffer);
+    if (nullptr == *data) {
+        ERRORLOG << "Getting data from saved buffer failed" << endl;
+        return nullptr;
+    }
+    size = buffer->size;
+    return buffer->frame;
+}
 
-    // Add to saved buffers
-    stream.buffers.push_back(Buffer{frameRef, vdoBuffer, size});
+// Save a frame in memory so that a client can request it later. The frame in
+// its slot is evicted, and given back to VDO unless it is still in use.
+// NB! Called with _mutex held
+uint32_t Capture::SaveFrame(Stream& stream, shared_ptr<SharedFrame> frame, size_t size) {
+    const uint32_t frameRef = NextFrameRef(stream.lastFrameRef);
+    Buffer& buffer = stream.buffers[frameRef % stream.buffers.size()];
+    if (buffer.frame) {
+        TRACELOG << "Evicting frame: " << buffer.id << endl;
+        evictedFramesMetric.Add();
+    }
+    buffer = Buffer{frameRef, move(frame), size};
+    stream.lastFrameRef = frameRef;
 
-    TRACELOG << "Queue size: " << stream.buffers.size() << endl;
-    TRACELOG << "Last frame reference: " << stream.buffers.back().id << endl;
+    TRACELOG << "Last frame reference: " << frameRef << endl;
 
     return frameRef;
 }
 
-// Delete the oldest frame if the queue is getting full
-void Capture::MaybeDeleteOldestFrame(Stream& stream) {
-    if (stream.buffers.size() >= MAX_NBR_SAVED_FRAMES) {
-        auto oldestBuffer = stream.buffers.front();
-        TRACELOG << "Unreferencing buffer: " << oldestBuffer.id << endl;
-        stream.buffers.pop_front();
-
-        // Free the buffer
-        if (!(vdo_stream_buffer_unref(stream.vdo_stream, &oldestBuffer.vdo_buffer, NULL))) {
-            ERRORLOG << "Unreferencing buffer failed" << endl;
-        }
+// Find a saved frame by its reference, nullptr if it has been evicted
+// NB! Called with _mutex held
+Buffer* Capture::FindSavedFrame(Stream& stream, uint32_t frameRef) {
+    Buffer& buffer = stream.buffers[frameRef % stream.buffers.size()];
+    if (0 == frameRef || buffer.id != frameRef || !buffer.frame) {
+        ERRORLOG << "Frame reference " << frameRef << " not found" << endl;
+        savedFrameMissesMetric.Add();
+        return nullptr;
     }
+    return &buffer;
 }
 
 // Find a frame based on the frame reference and put its data into the response
+// NB! Called with _mutex held
 bool Capture::GetDataFromSavedFrame(Stream& stream, uint32_t frameRef, GetFrameResponse* response) {
-    scoped_lock lock(_mutex);
     gpointer data = NULL;
 
-    // Find the buffer
-    auto buffer = find_if(stream.buffers.begin(), stream.buffers.end(), [&](const Buffer& buf) {
-        return buf.id == frameRef;
-    });
-    if (buffer == stream.buffers.end()) {
-        ERRORLOG << "Frame reference " << frameRef << " not found" << endl;
+    Buffer* buffer = FindSavedFrame(stream, frameRef);
+    if (nullptr == buffer) {
         return false;
     }
 
     TRACELOG << "Found saved VDO buffer. ID: " << buffer->id << endl;
 
-    data = vdo_buffer_get_data(buffer->vdo_buffer);
+    data = vdo_buffer_get_data(buffer->frame->vdo_buffer);
     if (nullptr == data) {
         ERRORLOG << "Getting data from saved buffer failed" << endl;
         return false;
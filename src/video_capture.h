@@ -20,59 +20,192 @@
 #include <vdo-buffer.h>
 #include <vdo-stream.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "videocapture.grpc.pb.h"
+#include "worker_pool.h"
 
 namespace acap_runtime {
 
-struct Buffer {
-    uint32_t id;
+// A frame taken from VDO, which is given back when the last reference to it
+// is released
+struct SharedFrame {
+    SharedFrame(VdoStream* stream, VdoBuffer* buffer);
+    ~SharedFrame();
+    SharedFrame(const SharedFrame&) = delete;
+    SharedFrame& operator=(const SharedFrame&) = delete;
+
+    VdoStream* vdo_stream;
     VdoBuffer* vdo_buffer;
-    size_t size;
 };
 
+/**
+ * @brief A VDO stream shared by all streams with the same settings
+ *
+ * Frames are taken from VDO once and kept in a ring, which every consumer
+ * reads with its own cursor. A frame leaves the ring when every consumer has
+ * read it, or when the ring is full and a slow consumer skips it.
+ *
+ * Frames are taken by the consumers as they need them, or by a prefetch
+ * thread as soon as VDO has them, so that the latest frame is at hand.
+ */
+class SharedStream {
+  public:
+    SharedStream(VdoStream* stream, const std::string& key);
+    ~SharedStream();
+    SharedStream(const SharedStream&) = delete;
+    SharedStream& operator=(const SharedStream&) = delete;
+
+    // Add a consumer, which reads the frames taken from now on, in order or
+    // only the latest one
+    uint64_t AddCursor(const bool latest = false);
+    void RemoveCursor(const uint64_t cursor);
+    // Next frame of a consumer, taken from VDO if the consumer has read all
+    // frames of the ring. nullptr on failure.
+    std::shared_ptr<SharedFrame> NextFrame(const uint64_t cursor, GError** error);
+    // Take frames from VDO in the background until the stream is stopped
+    void StartPrefetch();
+    void Stop();
+
+    VdoStream* const vdo_stream;
+    const std::string key;
+    // Streams of clients that share the stream, guarded by Capture::_mutex
+    unsigned int consumers = 0;
+
+  private:
+    struct Cursor {
+        uint64_t next;  // Next frame to read
+        bool latest;    // Skip to the latest frame
+    };
+
+    void Prefetch();
+    void Trim();
+
+    std::atomic<bool> _stopped{false};
+    std::thread _prefetch;
+    std::mutex _mutex;
+    std::condition_variable _fetched;
+    bool _fetching = false;                            // Guarded by _mutex
+    bool _prefetching = false;                         // Guarded by _mutex
+    std::deque<std::shared_ptr<SharedFrame>> _frames;  // Guarded by _mutex
+    uint64_t _firstFrame = 0;                          // Of _frames, guarded by _mutex
+    std::map<uint64_t, Cursor> _cursors;               // Guarded by _mutex
+    uint64_t _nextCursor = 0;                          // Guarded by _mutex
+};
+
+struct Buffer {
+    uint32_t id = 0;
+    std::shared_ptr<SharedFrame> frame;
+    size_t size = 0;
+};
+
+// A stream of a client
 struct Stream {
-    VdoStream* vdo_stream;
-    std::deque<Buffer> buffers;
+    std::shared_ptr<SharedStream> shared;
+    uint64_t cursor;
+    // Ring of saved frames, a frame is in the slot of its reference modulo
+    // the number of slots
+    std::vector<Buffer> buffers;
+    uint32_t lastFrameRef = 0;
+    // Memory of the saved frames, reserved from the budget
+    uint64_t savedMemory = 0;
 };
 
-class Capture final : public videocapture::v1::VideoCapture::Service {
+// Settings of the capture service
+struct CaptureSettings {
+    // Frames saved per stream, unless set when the stream is created
+    uint32_t savedFrames = 3;
+    // Memory in bytes of the saved frames of all streams. A stream always
+    // saves at least one frame.
+    uint64_t savedFrameMemory = 128 * 1024 * 1024;
+};
+
+class Capture final : public videocapture::v1::VideoCapture::CallbackService {
   public:
+    using CallbackServerContext = grpc::CallbackServerContext;
     using DeleteStreamRequest = videocapture::v1::DeleteStreamRequest;
     using DeleteStreamResponse = videocapture::v1::DeleteStreamResponse;
     using GetFrameRequest = videocapture::v1::GetFrameRequest;
     using GetFrameResponse = videocapture::v1::GetFrameResponse;
+    using GetFramesRequest = videocapture::v1::GetFramesRequest;
     using NewStreamRequest = videocapture::v1::NewStreamRequest;
     using NewStreamResponse = videocapture::v1::NewStreamResponse;
-    using ServerContext = grpc::ServerContext;
+    using ServerContextBase = grpc::ServerContextBase;
+    using ServerUnaryReactor = grpc::ServerUnaryReactor;
+    using ServerWriteReactor = grpc::ServerWriteReactor<GetFrameResponse>;
     using Status = grpc::Status;
     using StatusCode = grpc::StatusCode;
 
-    Capture(bool verbose);
-
-    Status NewStream(ServerContext* context,
+    Capture(bool verbose,
+            WorkerPool* workers = nullptr,
+            const CaptureSettings& settings = CaptureSettings());
+
+    // Callback API, the calls are run on the worker pool
+    ServerUnaryReactor* NewStream(CallbackServerContext* context,
+                                  const NewStreamRequest* request,
+                                  NewStreamResponse* response) override;
+    ServerUnaryReactor* DeleteStream(CallbackServerContext* context,
+                                     const DeleteStreamRequest* request,
+                                     DeleteStreamResponse* response) override;
+    ServerUnaryReactor* GetFrame(CallbackServerContext* context,
+                                 const GetFrameRequest* request,
+                                 GetFrameResponse* response) override;
+    // Stream the frames of a stream until the client cancels, each subscriber
+    // has its own capture thread
+    ServerWriteReactor* GetFrames(CallbackServerContext* context,
+                                  const GetFramesRequest* request) override;
+
+    Status NewStream(ServerContextBase* context,
                      const NewStreamRequest* request,
-                     NewStreamResponse* response) override;
+                     NewStreamResponse* response);
 
-    Status DeleteStream(ServerContext* context,
+    Status DeleteStream(ServerContextBase* context,
                         const DeleteStreamRequest* request,
-                        DeleteStreamResponse* response) override;
+                        DeleteStreamResponse* response);
 
-    Status GetFrame(ServerContext* context,
+    Status GetFrame(ServerContextBase* context,
                     const GetFrameRequest* request,
-                    GetFrameResponse* response) override;
-
-    bool GetImgDataFromStream(unsigned int stream, void** data, size_t& size, uint32_t& frameRef);
+                    GetFrameResponse* response);
+
+    // Export a frame by a duplicate of the file descriptor of its buffer,
+    // which the caller closes, instead of copying its data into the response.
+    // The buffer is only kept from VDO while the frame is saved, so frames are
+    // not exported from streams that save fewer than two frames.
+    Status ExportFrame(const GetFrameRequest* request, GetFrameResponse* response, int* fd);
+
+    // The data of a frame is valid while the returned frame is held, even if
+    // it is evicted meanwhile. Returns nullptr if there is no such frame.
+    std::shared_ptr<SharedFrame> GetImgDataFromStream(unsigned int stream,
+                                                      void** data,
+                                                      size_t& size,
+                                                      uint32_t& frameRef);
+    std::shared_ptr<SharedFrame> GetImgDataFromSavedFrame(unsigned int stream,
+                                                          uint32_t frameRef,
+                                                          void** data,
+                                                          size_t& size);
 
   private:
-    uint32_t SaveFrame(Stream& stream, VdoBuffer* vdoBuffer, size_t size);
+    class FrameWriter;
 
-    bool GetDataFromSavedFrame(Stream& stream, uint32_t frameRef, GetFrameResponse* response);
+    Status ReadFrame(SharedStream& stream, const uint64_t cursor, GetFrameResponse* response);
+
+    Status TakeFrame(unsigned int stream, std::shared_ptr<SharedFrame>& frame, uint32_t& frameRef);
+
+    void SetFrameInfo(VdoFrame* frame, GetFrameResponse* response);
 
-    void MaybeDeleteOldestFrame(Stream& stream);
+    uint32_t SaveFrame(Stream& stream, std::shared_ptr<SharedFrame> frame, size_t size);
+
+    Buffer* FindSavedFrame(Stream& stream, uint32_t frameRef);
+
+    bool GetDataFromSavedFrame(Stream& stream, uint32_t frameRef, GetFrameResponse* response);
 
     void PrintStreamInfo(VdoStream* stream);
 
@@ -81,9 +214,13 @@ class Capture final : public videocapture::v1::VideoCapture::Service {
 
     std::string GetTypeString(VdoFrame* frame);
 
-    std::map<unsigned int, Stream> _streams;
+    std::map<unsigned int, Stream> _streams;                       // Guarded by _mutex
+    std::map<std::string, std::weak_ptr<SharedStream>> _shared;  // By settings, guarded by _mutex
+    unsigned int _nextStreamId = 1;                                // Guarded by _mutex
     bool _verbose;
-    const uint32_t MAX_NBR_SAVED_FRAMES = 3;
+    WorkerPool* _workers;
+    CaptureSettings _settings;
+    uint64_t _savedMemory = 0;  // Guarded by _mutex
     std::mutex _mutex;
 };
 }  // namespace acap_runtime
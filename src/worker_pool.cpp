@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker_pool.h"
+#include "metrics.h"
+
+using namespace std;
+
+namespace acap_runtime {
+
+// Metrics of all pools, looked up once since they are updated with _mutex held
+static Metric& threadsMetric = Metrics::Register("workers.threads");
+static Metric& queuedMetric = Metrics::Register("workers.queued");
+static Metric& busyMetric = Metrics::Register("workers.busy");
+
+WorkerPool::WorkerPool(const unsigned int numThreads) {
+    for (unsigned int i = 0; i < numThreads; i++) {
+        _threads.emplace_back(&WorkerPool::Work, this);
+    }
+    threadsMetric.Set(numThreads);
+}
+
+// Queued work is done before the threads are stopped
+WorkerPool::~WorkerPool() {
+    {
+        scoped_lock lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Run(function<void()> work, const bool first) {
+    {
+        scoped_lock lock(_mutex);
+        if (first) {
+            _queue.push_front(move(work));
+        } else {
+            _queue.push_back(move(work));
+        }
+        queuedMetric.Set(_queue.size());
+    }
+    _wake.notify_one();
+}
+
+void WorkerPool::Work() {
+    unique_lock lock(_mutex);
+    while (true) {
+        _wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+        if (_queue.empty()) {
+            return;
+        }
+        function<void()> work = move(_queue.front());
+        _queue.pop_front();
+        queuedMetric.Set(_queue.size());
+        busyMetric.Add();
+        lock.unlock();
+        work();
+        busyMetric.Add(-1);
+        lock.lock();
+    }
+}
+}  // namespace acap_runtime
@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <grpcpp/grpcpp.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace acap_runtime {
+
+/**
+ * @brief Fixed set of threads that run the blocking calls of the services
+ *
+ * The services use the callback API of gRPC, whose threads must not block.
+ * Calls that wait for larod, VDO or the parameter service are run on the pool
+ * instead, so the number of threads does not grow with the number of calls.
+ */
+class WorkerPool {
+  public:
+    WorkerPool(const unsigned int numThreads);
+    ~WorkerPool();
+
+    // Queue work to be run on the next free thread, ahead of the queued work
+    // if first is set
+    void Run(std::function<void()> work, const bool first = false);
+
+  private:
+    void Work();
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _queue;  // Guarded by _mutex
+    bool _stopping = false;                    // Guarded by _mutex
+    std::mutex _mutex;
+    std::condition_variable _wake;
+};
+
+/**
+ * @brief Serve a unary call of the callback API with a blocking handler
+ *
+ * The handler is run on the pool, or directly on the gRPC thread if there is
+ * no pool, and the call is finished with the status it returns.
+ */
+template <typename Handler>
+grpc::ServerUnaryReactor* Dispatch(WorkerPool* workers,
+                                   grpc::CallbackServerContext* context,
+                                   Handler handler) {
+    grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+    if (nullptr == workers) {
+        reactor->Finish(handler());
+    } else {
+        workers->Run([reactor, handler]() { reactor->Finish(handler()); });
+    }
+    return reactor;
+}
+}  // namespace acap_runtime
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "predict.pb.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <iomanip>
+
+using namespace ::testing;
+using namespace std;
+using namespace std::chrono;
+using namespace tensorflow;
+using namespace tensorflow::serving;
+
+namespace acap_runtime {
+namespace ingestion_benchmark {
+
+const size_t RUNS = 20;
+
+// 1080p RGB input of a predict request
+PredictRequest CreateRequest() {
+    PredictRequest request;
+    TensorProto& input = (*request.mutable_inputs())["data"];
+    input.set_dtype(DataType::DT_UINT8);
+    for (int64_t size : {1, 1080, 1920, 3}) {
+        input.mutable_tensor_shape()->add_dim()->set_size(size);
+    }
+    input.mutable_tensor_content()->assign(1080 * 1920 * 3, 'x');
+    return request;
+}
+
+// The input as seen by preprocessing when it is passed by value
+size_t ByValue(TensorProto tp) {
+    return tp.tensor_content().size();
+}
+
+// The input as seen by preprocessing when it is passed by reference
+size_t ByReference(const TensorProto& tp) {
+    return tp.tensor_content().size();
+}
+
+// Time the ingestion of the request inputs, with the copies of a TensorProto
+// per input that were made before inputs were used in place
+TEST(IngestionBenchmark, InputCopies) {
+    const PredictRequest request = CreateRequest();
+    const TensorProto& input = request.inputs().at("data");
+    const double megabytes = input.tensor_content().size() / 1e6;
+    size_t total = 0;
+
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < RUNS; i++) {
+        for (auto& [name, tpa] : request.inputs()) {
+            TensorProto tp = tpa;
+            total += ByValue(tp);
+        }
+    }
+    const double copied = duration<double, milli>(steady_clock::now() - start).count() / RUNS;
+
+    start = steady_clock::now();
+    for (size_t i = 0; i < RUNS; i++) {
+        for (auto& [name, tp] : request.inputs()) {
+            total += ByReference(tp);
+        }
+    }
+    const double inPlace = duration<double, milli>(steady_clock::now() - start).count() / RUNS;
+
+    cout << fixed << setprecision(2) << "Ingestion of " << megabytes << " MB input: " << copied
+         << " ms with 2 copies, " << inPlace << " ms in place" << endl;
+    EXPECT_EQ(2 * RUNS * input.tensor_content().size(), total);
+
+    // Inputs iterated by reference alias the request
+    for (auto& [name, tp] : request.inputs()) {
+        EXPECT_EQ(input.tensor_content().data(), tp.tensor_content().data());
+    }
+}
+}  // namespace ingestion_benchmark
+}  // namespace acap_runtime
@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "message_arena.h"
+#include "predict.pb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <new>
+
+using namespace ::testing;
+using namespace std;
+using namespace std::chrono;
+using namespace tensorflow;
+using namespace tensorflow::serving;
+
+// Count the allocations of the test program
+static atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(0 == size ? 1 : size);
+    if (nullptr == p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace acap_runtime {
+namespace response_benchmark {
+
+const size_t RUNS = 20;
+
+// Outputs of a segmentation model and of a detection model with 20 detections
+const vector<pair<string, vector<int64_t>>> OUTPUTS = {
+    {"segmentation", {1, 513, 513, 21}},
+    {"TFLite_Detection_PostProcess", {1, 20, 4}},
+    {"TFLite_Detection_PostProcess:1", {1, 20}},
+    {"TFLite_Detection_PostProcess:2", {1, 20}},
+    {"TFLite_Detection_PostProcess:3", {1}}};
+
+void FillOutput(TensorProto& output, const vector<int64_t>& dims) {
+    output.set_dtype(DataType::DT_FLOAT);
+    size_t size = sizeof(float);
+    for (int64_t dim : dims) {
+        size *= dim;
+        auto tensorDim = output.mutable_tensor_shape()->add_dim();
+        tensorDim->set_size(dim);
+        tensorDim->set_name("size");
+    }
+    output.mutable_tensor_content()->resize(size);
+    output.set_version_number(0);
+}
+
+// Outputs built in a local tensor and assigned to the response
+void AssembleCopied(PredictResponse& response, const ModelSpec& modelSpec) {
+    for (auto& [name, dims] : OUTPUTS) {
+        TensorProto output;
+        FillOutput(output, dims);
+        (*response.mutable_outputs())[name] = output;
+    }
+    response.mutable_model_spec()->CopyFrom(modelSpec);
+}
+
+// Outputs built in place in the response
+void AssembleInPlace(PredictResponse& response, const ModelSpec& modelSpec) {
+    for (auto& [name, dims] : OUTPUTS) {
+        FillOutput((*response.mutable_outputs())[name], dims);
+    }
+    response.mutable_model_spec()->CopyFrom(modelSpec);
+}
+
+// Measure the allocations and time of assembling a response
+template <typename Assemble>
+pair<size_t, double> Measure(Assemble assemble, const ModelSpec& modelSpec) {
+    const size_t before = allocations;
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < RUNS; i++) {
+        PredictResponse response;
+        assemble(response, modelSpec);
+    }
+    return {(allocations - before) / RUNS,
+            duration<double, milli>(steady_clock::now() - start).count() / RUNS};
+}
+
+// Measure assembling a response in place, on the arena of a call
+pair<size_t, double> MeasureOnArena(const ModelSpec& modelSpec) {
+    ArenaAllocator<PredictRequest, PredictResponse> allocator;
+    const size_t before = allocations;
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < RUNS; i++) {
+        auto messages = allocator.AllocateMessages();
+        AssembleInPlace(*messages->response(), modelSpec);
+        messages->Release();
+    }
+    return {(allocations - before) / RUNS,
+            duration<double, milli>(steady_clock::now() - start).count() / RUNS};
+}
+
+TEST(ResponseBenchmark, OutputAssembly) {
+    ModelSpec modelSpec;
+    modelSpec.set_name("/models/detector.tflite");
+
+    auto [copiedAllocations, copiedMs] = Measure(AssembleCopied, modelSpec);
+    auto [inPlaceAllocations, inPlaceMs] = Measure(AssembleInPlace, modelSpec);
+    auto [arenaAllocations, arenaMs] = MeasureOnArena(modelSpec);
+    cout << fixed << setprecision(2) << "Response assembly: " << copiedAllocations
+         << " allocations in " << copiedMs << " ms with copies, " << inPlaceAllocations
+         << " allocations in " << inPlaceMs << " ms in place, " << arenaAllocations
+         << " allocations in " << arenaMs << " ms on an arena" << endl;
+    EXPECT_LT(inPlaceAllocations, copiedAllocations);
+    EXPECT_LT(arenaAllocations, inPlaceAllocations);
+
+    PredictResponse copied;
+    PredictResponse inPlace;
+    AssembleCopied(copied, modelSpec);
+    AssembleInPlace(inPlace, modelSpec);
+    for (auto& [name, dims] : OUTPUTS) {
+        EXPECT_TRUE(copied.outputs().at(name).SerializeAsString() ==
+                    inPlace.outputs().at(name).SerializeAsString())
+            << name;
+    }
+}
+}  // namespace response_benchmark
+}  // namespace acap_runtime
@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "client.h"
+#include <cstring>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace ::testing;
+using namespace std;
+using namespace tensorflow;
+
+namespace acap_runtime {
+namespace client_unittest {
+
+TEST(ClientUnittest, TensorView) {
+    const vector<float> values = {1, 2, 3, 4, 5, 6};
+    TensorProto tensor;
+    MakeTensorProto(tensor, DT_FLOAT, {2, 3}, values.data(), values.size() * sizeof(float));
+
+    // The view refers to the data of the tensor
+    TensorView view(tensor);
+    EXPECT_EQ(DT_FLOAT, view.DataType());
+    EXPECT_EQ(vector<int64_t>({2, 3}), view.Dims());
+    EXPECT_EQ(values.size(), view.Count<float>());
+    EXPECT_EQ(tensor.tensor_content().data(), view.Data<char>());
+    EXPECT_EQ(0, memcmp(values.data(), view.Data<float>(), view.Size()));
+}
+
+TEST(ClientUnittest, SharedInput) {
+    string name;
+    {
+        SharedInput input(64);
+        name = input.Name();
+        memset(input.Data(), 7, input.Size());
+        TensorProto tensor;
+        input.SetTensor(tensor, {1, 8, 8, 1});
+        EXPECT_EQ(DT_STRING, tensor.dtype());
+        ASSERT_EQ(1, tensor.string_val_size());
+        EXPECT_EQ(name, tensor.string_val(0));
+        EXPECT_EQ(4, tensor.tensor_shape().dim_size());
+
+        // The service opens the file by name
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        ASSERT_LE(0, fd);
+        uint8_t value = 0;
+        EXPECT_EQ(1, pread(fd, &value, 1, 63));
+        EXPECT_EQ(7, value);
+        close(fd);
+    }
+
+    // The file is removed with the input
+    EXPECT_GT(0, shm_open(name.c_str(), O_RDONLY, 0));
+}
+
+TEST(ClientUnittest, Latency) {
+    LatencyRecorder recorder;
+    EXPECT_EQ(0, recorder.Stats().calls);
+    for (int ms = 1; ms <= 100; ms++) {
+        recorder.Record(chrono::milliseconds(ms), 0 != ms % 10);
+    }
+    LatencyStats stats = recorder.Stats();
+    EXPECT_EQ(100, stats.calls);
+    EXPECT_EQ(10, stats.failures);
+    EXPECT_DOUBLE_EQ(50.5, stats.meanMs);
+    EXPECT_DOUBLE_EQ(100, stats.maxMs);
+    EXPECT_DOUBLE_EQ(50, stats.p50Ms);
+    EXPECT_DOUBLE_EQ(99, stats.p99Ms);
+
+    // Percentiles are of the latest calls
+    for (int i = 0; i < 2000; i++) {
+        recorder.Record(chrono::milliseconds(1), true);
+    }
+    stats = recorder.Stats();
+    EXPECT_EQ(2100, stats.calls);
+    EXPECT_DOUBLE_EQ(1, stats.p99Ms);
+    EXPECT_DOUBLE_EQ(100, stats.maxMs);
+}
+}  // namespace client_unittest
+}  // namespace acap_runtime
@@ -19,6 +19,7 @@
 #include "memory_use.h"
 #include "milli_seconds.h"
 #include "read_text.h"
+#include "runtime.h"
 #include "tensorflow_serving/apis/prediction_service.grpc.pb.h"
 #include "testdata.h"
 #include "verbose_setting.h"
@@ -493,6 +494,36 @@ TEST(InferenceTest, PredictCpuModel1) {
     main.join();
 }
 
+TEST(InferenceTest, PredictCpuModel1Embedded) {
+    // Predict in process, without a server
+    RuntimeSettings settings;
+    settings.verbose = get_verbose_status();
+    settings.chipId = atoi(cpuChipId);
+    settings.models = {cpuModel1};
+    Runtime runtime{settings};
+
+    int width;
+    int height;
+    int channels;
+    uchar* pixels;
+    ReadImage(imageFile1, &pixels, &width, &height, &channels);
+    PredictRequest request;
+    request.mutable_model_spec()->set_name(cpuModel1);
+    TensorProto& input = (*request.mutable_inputs())["data"];
+    input.set_dtype(tensorflow::DataType::DT_UINT8);
+    for (int size : {1, height, width, channels}) {
+        input.mutable_tensor_shape()->add_dim()->set_size(size);
+    }
+    input.set_tensor_content(pixels, width * height * channels);
+    free(pixels);
+
+    PredictResponse response;
+    ASSERT_TRUE(runtime.Predict(request, response).ok());
+    const string& scores = response.outputs().at("TFLite_Detection_PostProcess:2").tensor_content();
+    ASSERT_EQ(20 * sizeof(float), scores.size());
+    EXPECT_FLOAT_EQ(0.87890601, reinterpret_cast<const float*>(scores.data())[0]);
+}
+
 TEST(InferenceTest, PredictCpuModel2) {
     shm_unlink(sharedFile);
     thread main(Service, 8, cpuChipId);
@@ -18,8 +18,11 @@
 #include <gtest/gtest.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <fstream>
+#include <thread>
 #include "milli_seconds.h"
 #include "inference.h"
+#include "metrics.h"
 #include "bitmap.h"
 #include "testdata.h"
 #include "verbose_setting.h"
@@ -396,6 +399,83 @@ TEST(InferenceUnittest, PredictCpuModel1) {
 #endif
 }
 
+TEST(InferenceUnittest, GetModelMetadataCpuModel1) {
+    const bool verbose = get_verbose_status();
+    const vector<string> models = {};
+    Inference inference{verbose, cpuChipId, models, &capture};
+
+    GetModelMetadataRequest request;
+    request.mutable_model_spec()->set_name(cpuModel1);
+    request.add_metadata_field("signature_def");
+    request.add_metadata_field("tensor_layout");
+    GetModelMetadataResponse response;
+    ServerContext context;
+    ASSERT_TRUE(inference.GetModelMetadata(&context, &request, &response).ok());
+    EXPECT_EQ(cpuModel1, response.model_spec().name());
+
+    SignatureDefMap signatures;
+    ASSERT_TRUE(response.metadata().at("signature_def").UnpackTo(&signatures));
+    const SignatureDef& signature = signatures.signature_def().at("serving_default");
+    ASSERT_EQ(1, signature.inputs_size());
+    const TensorInfo& input = signature.inputs().begin()->second;
+    EXPECT_EQ(DataType::DT_UINT8, input.dtype());
+    ASSERT_EQ(4, input.tensor_shape().dim_size());
+    EXPECT_EQ(300, input.tensor_shape().dim(1).size());
+    EXPECT_EQ(300, input.tensor_shape().dim(2).size());
+    EXPECT_EQ(3, input.tensor_shape().dim(3).size());
+    ASSERT_EQ(4, signature.outputs_size());
+    EXPECT_EQ(DataType::DT_FLOAT,
+              signature.outputs().at("TFLite_Detection_PostProcess:1").dtype());
+
+    TensorLayoutMap layouts;
+    ASSERT_TRUE(response.metadata().at("tensor_layout").UnpackTo(&layouts));
+    const auto& layout = layouts.inputs().at(input.name());
+    EXPECT_EQ("NHWC", layout.layout());
+    ASSERT_EQ(4, layout.pitches_size());
+    EXPECT_EQ(300 * 300 * 3, layout.pitches(0));
+
+    // Unsupported fields are rejected
+    request.add_metadata_field("invalid");
+    response.Clear();
+    EXPECT_EQ(StatusCode::INVALID_ARGUMENT,
+              inference.GetModelMetadata(&context, &request, &response).error_code());
+}
+
+TEST(InferenceUnittest, ReloadCpuModel1) {
+    const bool verbose = get_verbose_status();
+    const string modelFile = "/tmp/reload_unittest.tflite";
+    auto copyModel = [&modelFile] {
+        ifstream in(cpuModel1, ios::binary);
+        ofstream out(modelFile, ios::binary | ios::trunc);
+        out << in.rdbuf();
+    };
+    copyModel();
+    shm_unlink(sharedFile);
+
+    InferenceSettings settings;
+    settings.watchModels = true;
+    Inference inference{verbose, cpuChipId, {modelFile}, &capture, settings};
+    PredictModel1(inference, modelFile, imageFile1, 0.87890601, 0.58203125, false);
+
+    // Reload on request
+    const double succeeded = Metrics::Get("reload.succeeded");
+    EXPECT_TRUE(inference.ReloadModel(modelFile));
+    EXPECT_EQ(succeeded + 1, Metrics::Get("reload.succeeded"));
+    PredictModel1(inference, modelFile, imageFile1, 0.87890601, 0.58203125, false);
+
+    // Reload when the file is rewritten
+    copyModel();
+    for (int i = 0; i < 100 && succeeded + 2 > Metrics::Get("reload.succeeded"); i++) {
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    EXPECT_EQ(succeeded + 2, Metrics::Get("reload.succeeded"));
+    PredictModel1(inference, modelFile, imageFile1, 0.87890601, 0.58203125, false);
+
+    // A model that is not loaded can not be reloaded
+    EXPECT_FALSE(inference.ReloadModel(cpuModel2));
+    unlink(modelFile.c_str());
+}
+
 TEST(InferenceUnittest, PredictCpuModel2) {
     const bool verbose = get_verbose_status();
     const vector<string> models = {};
@@ -0,0 +1,272 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "local_transport.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace ::testing;
+using namespace std;
+using namespace tensorflow;
+using namespace tensorflow::serving;
+
+namespace acap_runtime {
+namespace local_transport_unittest {
+
+const string socketPath = "/tmp/acap-runtime-local-unittest.sock";
+
+// Doubles the values of input "in" into output "out"
+grpc::Status DoubleValues(const PredictRequest* request, PredictResponse* response) {
+    auto input = request->inputs().find("in");
+    if (request->inputs().end() == input) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "No input");
+    }
+    const string& content = input->second.tensor_content();
+    vector<float> values(content.size() / sizeof(float));
+    memcpy(values.data(), content.data(), content.size());
+    for (float& value : values) {
+        value *= 2;
+    }
+    TensorProto& output = (*response->mutable_outputs())["out"];
+    output.set_dtype(DT_FLOAT);
+    *output.mutable_tensor_shape() = input->second.tensor_shape();
+    output.set_tensor_content(values.data(), values.size() * sizeof(float));
+    return grpc::Status::OK;
+}
+
+void Double(const PredictRequest* request,
+            PredictResponse* response,
+            LocalTransport::DoneFunc done) {
+    done(DoubleValues(request, response));
+}
+
+// Answers on the worker pool, after the handler has returned
+LocalTransport::Handler DoubleOnPool(WorkerPool& workers) {
+    return [&workers](const PredictRequest* request,
+                      PredictResponse* response,
+                      LocalTransport::DoneFunc done) {
+        workers.Run([request, response, done] { done(DoubleValues(request, response)); });
+    };
+}
+
+// Exports frame 7 of stream 1, at an offset in a memory file
+grpc::Status ExportFrame(const LocalTransport::GetFrameRequest* request,
+                         LocalTransport::GetFrameResponse* response,
+                         int* fd) {
+    if (1 != request->stream_id()) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "No stream");
+    }
+    const string name = "/acap-runtime-frame-unittest";
+    *fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    shm_unlink(name.c_str());
+    const string data(100, 'f');
+    if (0 > *fd || data.size() != pwrite(*fd, data.data(), data.size(), 4096)) {
+        return grpc::Status(grpc::StatusCode::INTERNAL, "No memory file");
+    }
+    response->set_frame_reference(7);
+    response->set_offset(4096);
+    response->set_size(data.size());
+    response->set_sequence_nbr(42);
+    response->set_type("yuv");
+    return grpc::Status::OK;
+}
+
+TEST(LocalTransportUnittest, Ring) {
+    // Indices keep their order across threads and wrap around the slots
+    vector<uint8_t> memory(LocalSharedSize(2, 64));
+    LocalShared* shared = new (memory.data()) LocalShared{};
+    shared->numSlots = 2;
+    shared->slotSize = 64;
+    LocalRing producer = LocalRequestRing(shared);
+    LocalRing consumer = LocalRequestRing(shared);
+    EXPECT_EQ(nullptr, consumer.Peek());
+
+    const uint32_t count = 10000;
+    thread produce([&] {
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t* slot;
+            while (nullptr == (slot = producer.Claim())) {
+                this_thread::yield();
+            }
+            memcpy(slot, &i, sizeof(i));
+            producer.Publish();
+        }
+    });
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t* slot;
+        while (nullptr == (slot = consumer.Peek())) {
+            this_thread::yield();
+        }
+        uint32_t value;
+        memcpy(&value, slot, sizeof(value));
+        ASSERT_EQ(i, value);
+        consumer.Release();
+    }
+    produce.join();
+    EXPECT_EQ(nullptr, consumer.Peek());
+}
+
+TEST(LocalTransportUnittest, Predict) {
+    WorkerPool workers{2};
+    LocalTransport transport(
+        false, socketPath, 4, 1 << 16, DoubleOnPool(workers), nullptr, &workers);
+    LocalRingClient client;
+    ASSERT_TRUE(client.Connect(socketPath));
+
+    // More requests than slots, posted as slots are given back
+    const vector<float> values = {1, 2, 3, 4, 5, 6};
+    const size_t size = values.size() * sizeof(float);
+    set<uint64_t> ids;
+    uint64_t posted = 0;
+    while (ids.size() < 10) {
+        while (posted < 10 && nullptr != client.BeginRequest(posted, "model")) {
+            uint8_t* data = client.AddInput("in", DT_FLOAT, {1, 2, 3}, size);
+            ASSERT_NE(nullptr, data);
+            memcpy(data, values.data(), size);
+            ASSERT_TRUE(client.PostRequest());
+            posted++;
+        }
+
+        const LocalMessage* response = client.WaitResponse(5000);
+        ASSERT_NE(nullptr, response);
+        EXPECT_EQ(grpc::StatusCode::OK, response->status);
+        ASSERT_EQ(1, response->numTensors);
+        const LocalTensor& tensor = response->tensors[0];
+        EXPECT_STREQ("out", tensor.name);
+        EXPECT_EQ(DT_FLOAT, tensor.dtype);
+        ASSERT_EQ(3, tensor.numDims);
+        EXPECT_EQ(3, tensor.dims[2]);
+        ASSERT_EQ(size, tensor.size);
+        const float* result = reinterpret_cast<const float*>(client.TensorData(response, tensor));
+        for (size_t i = 0; i < values.size(); i++) {
+            EXPECT_EQ(2 * values[i], result[i]);
+        }
+        ids.insert(response->id);
+        client.ReleaseResponse();
+    }
+    EXPECT_EQ(10, ids.size());
+}
+
+TEST(LocalTransportUnittest, ResponsesWaitForSlots) {
+    LocalTransport transport(false, socketPath, 2, 4096, Double);
+    LocalRingClient client;
+    ASSERT_TRUE(client.Connect(socketPath));
+
+    // Requests are served on the loop thread while the client holds every
+    // response slot, and their responses are written as slots are released
+    const uint64_t count = 6;
+    uint64_t posted = 0;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (posted < count && chrono::steady_clock::now() < deadline) {
+        if (nullptr == client.BeginRequest(posted, "model")) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+            continue;
+        }
+        ASSERT_TRUE(client.PostRequest());
+        posted++;
+    }
+    ASSERT_EQ(count, posted);
+
+    for (uint64_t i = 0; i < count; i++) {
+        const LocalMessage* response = client.WaitResponse(5000);
+        ASSERT_NE(nullptr, response);
+        EXPECT_EQ(i, response->id);
+        EXPECT_EQ(grpc::StatusCode::INVALID_ARGUMENT, response->status);
+        EXPECT_TRUE(client.ReleaseResponse());
+    }
+    EXPECT_EQ(nullptr, client.WaitResponse(10));
+}
+
+TEST(LocalTransportUnittest, Frame) {
+    WorkerPool workers{2};
+    LocalTransport transport(false, socketPath, 2, 4096, Double, ExportFrame, &workers);
+    LocalRingClient client;
+    ASSERT_TRUE(client.Connect(socketPath));
+
+    // The frame is read through the received file descriptor
+    ASSERT_NE(nullptr, client.BeginFrameRequest(1, 1));
+    ASSERT_TRUE(client.PostRequest());
+    const LocalMessage* response = client.WaitResponse(5000);
+    ASSERT_NE(nullptr, response);
+    EXPECT_EQ(1, response->id);
+    EXPECT_EQ(LOCAL_FRAME, response->kind);
+    ASSERT_EQ(grpc::StatusCode::OK, response->status);
+    EXPECT_EQ(7, response->frame.frameReference);
+    EXPECT_EQ(42, response->frame.sequenceNbr);
+    EXPECT_STREQ("yuv", response->frame.type);
+    const LocalFrame frame = response->frame;
+    client.ReleaseResponse();
+    int fd = client.ReceiveFrame();
+    ASSERT_LE(0, fd);
+    string data(frame.size, '\0');
+    EXPECT_EQ(frame.size, pread(fd, data.data(), frame.size, frame.offset));
+    EXPECT_EQ(string(100, 'f'), data);
+    close(fd);
+
+    // No file descriptor is sent with an error
+    ASSERT_NE(nullptr, client.BeginFrameRequest(2, 2));
+    ASSERT_TRUE(client.PostRequest());
+    response = client.WaitResponse(5000);
+    ASSERT_NE(nullptr, response);
+    EXPECT_EQ(LOCAL_FRAME, response->kind);
+    EXPECT_EQ(grpc::StatusCode::FAILED_PRECONDITION, response->status);
+    client.ReleaseResponse();
+}
+
+TEST(LocalTransportUnittest, Errors) {
+    LocalTransport transport(false, socketPath, 2, 4096, Double);
+    LocalRingClient client;
+    ASSERT_TRUE(client.Connect(socketPath));
+
+    // Status of the handler
+    ASSERT_NE(nullptr, client.BeginRequest(1, "model"));
+    ASSERT_TRUE(client.PostRequest());
+    const LocalMessage* response = client.WaitResponse(5000);
+    ASSERT_NE(nullptr, response);
+    EXPECT_EQ(1, response->id);
+    EXPECT_EQ(grpc::StatusCode::INVALID_ARGUMENT, response->status);
+    client.ReleaseResponse();
+
+    // Inputs that do not fit are refused by the client
+    ASSERT_NE(nullptr, client.BeginRequest(2, "model"));
+    EXPECT_EQ(nullptr, client.AddInput("in", DT_FLOAT, {4096}, 4096 * sizeof(float)));
+
+    // Tensors outside the slot are refused by the service
+    LocalMessage* request = client.BeginRequest(3, "model");
+    ASSERT_NE(nullptr, client.AddInput("in", DT_FLOAT, {4}, 4 * sizeof(float)));
+    request->tensors[0].size = 1 << 20;
+    ASSERT_TRUE(client.PostRequest());
+    response = client.WaitResponse(5000);
+    ASSERT_NE(nullptr, response);
+    EXPECT_EQ(3, response->id);
+    EXPECT_EQ(grpc::StatusCode::INVALID_ARGUMENT, response->status);
+    client.ReleaseResponse();
+
+    // Frames are not exported without a handler
+    ASSERT_NE(nullptr, client.BeginFrameRequest(4, 1));
+    ASSERT_TRUE(client.PostRequest());
+    response = client.WaitResponse(5000);
+    ASSERT_NE(nullptr, response);
+    EXPECT_EQ(grpc::StatusCode::UNIMPLEMENTED, response->status);
+    client.ReleaseResponse();
+}
+}  // namespace local_transport_unittest
+}  // namespace acap_runtime
@@ -0,0 +1,53 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "message_arena.h"
+#include "predict.pb.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace tensorflow::serving;
+
+namespace acap_runtime {
+namespace message_arena_unittest {
+
+TEST(MessageArenaUnittest, MessagesOnArena) {
+    ArenaAllocator<PredictRequest, PredictResponse> allocator;
+    auto messages = allocator.AllocateMessages();
+    ASSERT_NE(nullptr, messages->request());
+    ASSERT_NE(nullptr, messages->response());
+    EXPECT_NE(nullptr, messages->request()->GetArena());
+    EXPECT_EQ(messages->request()->GetArena(), messages->response()->GetArena());
+
+    // Outputs added to the response are created on the arena of the call
+    auto& output = (*messages->response()->mutable_outputs())["output"];
+    output.mutable_tensor_shape()->add_dim()->set_size(4);
+    output.mutable_tensor_content()->assign(16, 'x');
+    EXPECT_EQ(messages->response()->GetArena(), output.GetArena());
+    EXPECT_EQ(messages->response()->GetArena(), output.tensor_shape().GetArena());
+    messages->Release();
+}
+
+TEST(MessageArenaUnittest, ArenaPerCall) {
+    ArenaAllocator<PredictRequest, PredictResponse> allocator;
+    auto first = allocator.AllocateMessages();
+    auto second = allocator.AllocateMessages();
+    EXPECT_NE(first->response()->GetArena(), second->response()->GetArena());
+    first->Release();
+    second->Release();
+}
+}  // namespace message_arena_unittest
+}  // namespace acap_runtime
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "placement.h"
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace ::testing;
+using namespace std;
+
+namespace acap_runtime {
+namespace placement_unittest {
+
+const string placementFile = "/tmp/placement_unittest.txt";
+
+TEST(PlacementUnittest, Fastest) {
+    EXPECT_EQ(0u, Placement::Fastest({}));
+    EXPECT_EQ(12u, Placement::Fastest({{2, 80.5}, {4, 30}, {12, 7.25}}));
+}
+
+TEST(PlacementUnittest, StoreAndLoad) {
+    unlink(placementFile.c_str());
+    {
+        Placement placement{placementFile};
+        PlacementRecord record{1024, 1700000000, 12, {{2, 80.5}, {12, 7.25}}};
+        EXPECT_TRUE(placement.Store("/models/detector.tflite", record));
+    }
+
+    Placement placement{placementFile};
+    PlacementRecord record;
+    ASSERT_TRUE(placement.Find("/models/detector.tflite", 1024, 1700000000, record));
+    EXPECT_EQ(12u, record.chip);
+    EXPECT_EQ((map<uint64_t, double>{{2, 80.5}, {12, 7.25}}), record.latencies);
+    EXPECT_FALSE(placement.Find("/models/other.tflite", 1024, 1700000000, record));
+    unlink(placementFile.c_str());
+}
+
+TEST(PlacementUnittest, ChangedModel) {
+    Placement placement{""};
+    PlacementRecord record{1024, 1700000000, 4, {{4, 10}}};
+    EXPECT_TRUE(placement.Store("model.tflite", record));
+    EXPECT_FALSE(placement.Find("model.tflite", 2048, 1700000000, record));
+    EXPECT_FALSE(placement.Find("model.tflite", 1024, 1700000001, record));
+}
+
+TEST(PlacementUnittest, SkipMalformedLines) {
+    {
+        ofstream out(placementFile, ios::trunc);
+        out << "broken line\n";
+        out << "model.tflite\t100\t5\t2\t2:3.5\n";
+    }
+    Placement placement{placementFile};
+    PlacementRecord record;
+    ASSERT_TRUE(placement.Find("model.tflite", 100, 5, record));
+    EXPECT_EQ(2u, record.chip);
+    EXPECT_FALSE(placement.Find("broken line", 0, 0, record));
+    unlink(placementFile.c_str());
+}
+}  // namespace placement_unittest
+}  // namespace acap_runtime
@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics.h"
+#include "result_cache.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace ::testing;
+using namespace std;
+
+namespace acap_runtime {
+namespace result_cache_unittest {
+
+ResultCache::PredictResponse Response(uint32_t frameReference) {
+    ResultCache::PredictResponse response;
+    response.set_frame_reference(frameReference);
+    return response;
+}
+
+TEST(ResultCacheUnittest, Disabled) {
+    ResultCache cache{0, 1000};
+    ResultCache::PredictResponse response;
+    EXPECT_FALSE(cache.Enabled());
+    cache.Insert("key", Response(1), cache.Generation());
+    EXPECT_FALSE(cache.Lookup("key", response));
+}
+
+TEST(ResultCacheUnittest, HitAndMiss) {
+    ResultCache cache{4, 1000};
+    ResultCache::PredictResponse response;
+    const double hits = Metrics::Get("cache.hits");
+    const double misses = Metrics::Get("cache.misses");
+
+    EXPECT_FALSE(cache.Lookup("key", response));
+    cache.Insert("key", Response(7), cache.Generation());
+    ASSERT_TRUE(cache.Lookup("key", response));
+    EXPECT_EQ(7u, response.frame_reference());
+    EXPECT_FALSE(cache.Lookup("other", response));
+    EXPECT_EQ(hits + 1, Metrics::Get("cache.hits"));
+    EXPECT_EQ(misses + 2, Metrics::Get("cache.misses"));
+}
+
+TEST(ResultCacheUnittest, Expired) {
+    ResultCache cache{4, 10};
+    ResultCache::PredictResponse response;
+    cache.Insert("key", Response(1), cache.Generation());
+    this_thread::sleep_for(chrono::milliseconds(20));
+    EXPECT_FALSE(cache.Lookup("key", response));
+}
+
+TEST(ResultCacheUnittest, EvictLeastRecentlyUsed) {
+    ResultCache cache{2, 1000};
+    ResultCache::PredictResponse response;
+    cache.Insert("a", Response(1), cache.Generation());
+    cache.Insert("b", Response(2), cache.Generation());
+    EXPECT_TRUE(cache.Lookup("a", response));
+    cache.Insert("c", Response(3), cache.Generation());
+    EXPECT_TRUE(cache.Lookup("a", response));
+    EXPECT_FALSE(cache.Lookup("b", response));
+    EXPECT_TRUE(cache.Lookup("c", response));
+    EXPECT_EQ(2, Metrics::Get("cache.entries"));
+}
+
+TEST(ResultCacheUnittest, Clear) {
+    ResultCache cache{4, 1000};
+    ResultCache::PredictResponse response;
+    cache.Insert("a", Response(1), cache.Generation());
+    cache.Insert("b", Response(2), cache.Generation());
+    cache.Clear();
+    EXPECT_FALSE(cache.Lookup("a", response));
+    EXPECT_FALSE(cache.Lookup("b", response));
+    EXPECT_EQ(0, Metrics::Get("cache.entries"));
+}
+
+TEST(ResultCacheUnittest, ClearedDuringRequest) {
+    ResultCache cache{4, 1000};
+    ResultCache::PredictResponse response;
+
+    // The result of a request that started before a clear is not kept
+    const uint64_t generation = cache.Generation();
+    cache.Clear();
+    cache.Insert("a", Response(1), generation);
+    EXPECT_FALSE(cache.Lookup("a", response));
+    cache.Insert("a", Response(2), cache.Generation());
+    ASSERT_TRUE(cache.Lookup("a", response));
+    EXPECT_EQ(2u, response.frame_reference());
+}
+
+TEST(ResultCacheUnittest, NotCachable) {
+    ResultCache cache{4, 1000};
+    ResultCache::PredictResponse response;
+    const double misses = Metrics::Get("cache.misses");
+    cache.Insert("", Response(1), cache.Generation());
+    EXPECT_FALSE(cache.Lookup("", response));
+    EXPECT_EQ(misses, Metrics::Get("cache.misses"));
+}
+
+TEST(ResultCacheUnittest, EvictBySize) {
+    ResultCache::PredictResponse large = Response(1);
+    (*large.mutable_outputs())["output"].set_tensor_content(string(1000, 'x'));
+    ResultCache cache{10, 1000, 2500};
+    ResultCache::PredictResponse response;
+    cache.Insert("a", large, cache.Generation());
+    cache.Insert("b", large, cache.Generation());
+    cache.Insert("c", large, cache.Generation());
+    EXPECT_FALSE(cache.Lookup("a", response));
+    EXPECT_TRUE(cache.Lookup("b", response));
+    EXPECT_TRUE(cache.Lookup("c", response));
+    EXPECT_GE(2500, Metrics::Get("cache.bytes"));
+
+    // A result larger than the cache is not kept
+    (*large.mutable_outputs())["output"].set_tensor_content(string(3000, 'x'));
+    cache.Insert("d", large, cache.Generation());
+    EXPECT_FALSE(cache.Lookup("d", response));
+    EXPECT_TRUE(cache.Lookup("c", response));
+}
+
+TEST(ResultCacheUnittest, Hash) {
+    vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 7;
+    }
+    const uint64_t hash = ResultCache::Hash(data.data(), data.size());
+    EXPECT_EQ(hash, ResultCache::Hash(data.data(), data.size()));
+    EXPECT_NE(hash, ResultCache::Hash(data.data(), data.size(), 1));
+    EXPECT_NE(hash, ResultCache::Hash(data.data(), data.size() - 1));
+
+    // Every byte, including the tail, affects the hash
+    for (size_t i : {0, 31, 500, 996, 999}) {
+        data[i] ^= 1;
+        EXPECT_NE(hash, ResultCache::Hash(data.data(), data.size())) << "Byte " << i;
+        data[i] ^= 1;
+    }
+}
+}  // namespace result_cache_unittest
+}  // namespace acap_runtime
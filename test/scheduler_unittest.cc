@@ -0,0 +1,297 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics.h"
+#include "scheduler.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace ::testing;
+using namespace std;
+using namespace std::chrono;
+
+namespace acap_runtime {
+namespace scheduler_unittest {
+
+const auto queueDelay = milliseconds(20);
+
+struct Request {
+    Priority priority;
+    string client;
+    string model;
+};
+
+// Queue the requests, in order, behind a running request and return the
+// order in which they are executed
+vector<string> RunQueued(Scheduler& scheduler, const vector<Request>& requests) {
+    vector<string> order;
+    mutex orderMutex;
+    vector<thread> threads;
+
+    scheduler.Acquire(Priority::HIGH, "blocker", "model");
+    for (auto& request : requests) {
+        threads.emplace_back([&, request] {
+            Scheduler::Slot slot(scheduler, request.priority, request.client, request.model);
+            scoped_lock lock(orderMutex);
+            order.push_back(request.client);
+        });
+        this_thread::sleep_for(queueDelay);
+    }
+    scheduler.Release("model", 0, milliseconds(1));
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return order;
+}
+
+TEST(SchedulerUnittest, ParsePriority) {
+    EXPECT_EQ(Priority::HIGH, Scheduler::ParsePriority("high"));
+    EXPECT_EQ(Priority::LOW, Scheduler::ParsePriority("low"));
+    EXPECT_EQ(Priority::NORMAL, Scheduler::ParsePriority(""));
+    EXPECT_EQ(Priority::NORMAL, Scheduler::ParsePriority("invalid"));
+}
+
+TEST(SchedulerUnittest, HighPriorityFirst) {
+    Scheduler scheduler{false, 0, {}};
+    auto order = RunQueued(scheduler,
+                           {{Priority::LOW, "low", "model"},
+                            {Priority::NORMAL, "normal", "model"},
+                            {Priority::HIGH, "high", "model"}});
+    EXPECT_EQ((vector<string>{"high", "normal", "low"}), order);
+}
+
+TEST(SchedulerUnittest, FairBetweenClients) {
+    Scheduler scheduler{false, 0, {}};
+    auto order = RunQueued(scheduler,
+                           {{Priority::NORMAL, "bulk", "model"},
+                            {Priority::NORMAL, "bulk", "model"},
+                            {Priority::NORMAL, "bulk", "model"},
+                            {Priority::NORMAL, "live", "model"}});
+    EXPECT_EQ((vector<string>{"bulk", "live", "bulk", "bulk"}), order);
+}
+
+TEST(SchedulerUnittest, WeightedClients) {
+    Scheduler scheduler{false, 0, {{"live", 2}}};
+    auto order = RunQueued(scheduler,
+                           {{Priority::NORMAL, "bulk", "model"},
+                            {Priority::NORMAL, "bulk", "model"},
+                            {Priority::NORMAL, "live", "model"},
+                            {Priority::NORMAL, "live", "model"},
+                            {Priority::NORMAL, "live", "model"}});
+    EXPECT_EQ((vector<string>{"bulk", "live", "live", "bulk", "live"}), order);
+}
+
+TEST(SchedulerUnittest, StarvationLimit) {
+    Scheduler scheduler{false, 10, {}};
+    const double promoted = Metrics::Get("scheduler.promoted");
+    auto order = RunQueued(scheduler,
+                           {{Priority::LOW, "low", "model"},
+                            {Priority::HIGH, "high", "model"},
+                            {Priority::HIGH, "high", "model"}});
+    EXPECT_EQ("low", order.front());
+    EXPECT_EQ(promoted + 1, Metrics::Get("scheduler.promoted"));
+}
+
+TEST(SchedulerUnittest, DropExpiredDeadline) {
+    Scheduler scheduler{false, 0, {}};
+    const double dropped = Metrics::Get("scheduler.dropped.deadline");
+    scheduler.Acquire(Priority::HIGH, "blocker", "model");
+    EXPECT_EQ(Scheduler::Result::DROPPED,
+              scheduler.Acquire(
+                  Priority::HIGH, "late", "model", Scheduler::Clock::now() + queueDelay));
+    EXPECT_EQ(dropped + 1, Metrics::Get("scheduler.dropped.deadline"));
+    scheduler.Release("model", 0, milliseconds(1));
+}
+
+TEST(SchedulerUnittest, DropUnreachableDeadline) {
+    Scheduler scheduler{false, 0, {}};
+    scheduler.Acquire(Priority::HIGH, "client", "model");
+    scheduler.Release("model", 0, seconds(1));
+    EXPECT_EQ(Scheduler::Result::DROPPED,
+              scheduler.Acquire(Priority::HIGH,
+                                "client",
+                                "model",
+                                Scheduler::Clock::now() + milliseconds(100)));
+    EXPECT_EQ(
+        Scheduler::Result::ACQUIRED,
+        scheduler.Acquire(Priority::HIGH, "client", "model", Scheduler::Clock::now() + seconds(2)));
+}
+
+TEST(SchedulerUnittest, DropCancelled) {
+    Scheduler scheduler{false, 0, {}};
+    const double dropped = Metrics::Get("scheduler.dropped.cancelled");
+    atomic<bool> cancelled = false;
+    scheduler.Acquire(Priority::HIGH, "blocker", "model");
+    thread waiting([&] {
+        Scheduler::Slot slot(scheduler,
+                             Priority::NORMAL,
+                             "client",
+                             "model",
+                             Scheduler::Clock::time_point::max(),
+                             [&] { return cancelled.load(); });
+        EXPECT_FALSE(slot.Acquired());
+    });
+    this_thread::sleep_for(queueDelay);
+    cancelled = true;
+    waiting.join();
+    EXPECT_EQ(dropped + 1, Metrics::Get("scheduler.dropped.cancelled"));
+    EXPECT_EQ(0, Metrics::Get("scheduler.normal.queue_depth"));
+    scheduler.Release("model", 0, milliseconds(1));
+}
+
+TEST(SchedulerUnittest, RejectAboveLimit) {
+    Scheduler scheduler{false, 0, {}, 2, {{"small", 1}}};
+    const double rejected = Metrics::Get("scheduler.rejected");
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, scheduler.Acquire(Priority::HIGH, "client", "small"));
+    EXPECT_EQ(Scheduler::Result::REJECTED, scheduler.Acquire(Priority::HIGH, "client", "small"));
+    thread queued([&] {
+        Scheduler::Slot slot(scheduler, Priority::LOW, "client", "large");
+        EXPECT_TRUE(slot.Acquired());
+    });
+    this_thread::sleep_for(queueDelay);
+    EXPECT_EQ(Scheduler::Result::REJECTED, scheduler.Acquire(Priority::HIGH, "client", "large"));
+    EXPECT_EQ(rejected + 2, Metrics::Get("scheduler.rejected"));
+
+    scheduler.Release("small", 0, milliseconds(10));
+    queued.join();
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, scheduler.Acquire(Priority::HIGH, "client", "small"));
+    EXPECT_EQ(milliseconds(10), scheduler.Backlog());
+    scheduler.Release("small", 0, milliseconds(10));
+}
+
+TEST(SchedulerUnittest, Capacity) {
+    Scheduler scheduler{false, 0, {}, 0, {}, 2};
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, scheduler.Acquire(Priority::HIGH, "first", "model"));
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, scheduler.Acquire(Priority::HIGH, "second", "model"));
+    EXPECT_EQ(Scheduler::Result::DROPPED,
+              scheduler.Acquire(
+                  Priority::HIGH, "third", "model", Scheduler::Clock::now() + queueDelay));
+    scheduler.Release("model", 0, milliseconds(10));
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, scheduler.Acquire(Priority::HIGH, "third", "model"));
+    EXPECT_EQ(milliseconds(10), scheduler.Backlog());
+}
+
+TEST(SchedulerUnittest, SetCapacity) {
+    Scheduler scheduler{false, 0, {}};
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, scheduler.Acquire(Priority::HIGH, "first", "model"));
+    thread queued([&] {
+        Scheduler::Slot slot(scheduler, Priority::HIGH, "second", "model");
+        EXPECT_TRUE(slot.Acquired());
+    });
+    this_thread::sleep_for(queueDelay);
+    scheduler.SetCapacity(2);
+    queued.join();
+    scheduler.Release("model", 0, milliseconds(10));
+}
+
+TEST(SchedulerUnittest, ModelOnOneReplica) {
+    Scheduler scheduler{false, 0, {}, 0, {}, 2};
+    scheduler.PlaceModel("model", {1});
+    const auto never = Scheduler::Clock::time_point::max();
+    unsigned int replica;
+    EXPECT_EQ(Scheduler::Result::ACQUIRED,
+              scheduler.Acquire(Priority::HIGH, "first", "model", never, nullptr, &replica));
+    EXPECT_EQ(1, replica);
+
+    // The other replica is idle, but does not hold the model
+    EXPECT_EQ(Scheduler::Result::DROPPED,
+              scheduler.Acquire(
+                  Priority::HIGH, "second", "model", Scheduler::Clock::now() + queueDelay));
+    EXPECT_EQ(Scheduler::Result::ACQUIRED,
+              scheduler.Acquire(Priority::HIGH, "other", "other", never, nullptr, &replica));
+    EXPECT_EQ(0, replica);
+
+    // Requests waiting for the replica of their model run one at a time, by priority
+    vector<string> order;
+    mutex orderMutex;
+    vector<thread> threads;
+    for (auto& [priority, client] : {make_pair(Priority::LOW, "low"),
+                                     make_pair(Priority::HIGH, "high")}) {
+        threads.emplace_back([&, priority = priority, client = client] {
+            Scheduler::Slot slot(scheduler, priority, client, "model");
+            EXPECT_EQ(1, slot.Replica());
+            scoped_lock lock(orderMutex);
+            order.push_back(client);
+        });
+        this_thread::sleep_for(queueDelay);
+    }
+    scheduler.Release("model", 1, milliseconds(1));
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ((vector<string>{"high", "low"}), order);
+    scheduler.Release("other", 0, milliseconds(1));
+}
+
+TEST(SchedulerUnittest, EnqueueWithoutBlocking) {
+    Scheduler scheduler{false, 0, {}, 2};
+    vector<Scheduler::Result> results;
+    auto done = [&results](const Scheduler::Result result, unsigned int) {
+        results.push_back(result);
+    };
+    scheduler.Enqueue(Priority::HIGH,
+                      "first",
+                      "model",
+                      Scheduler::Clock::time_point::max(),
+                      nullptr,
+                      done);
+    EXPECT_EQ((vector<Scheduler::Result>{Scheduler::Result::ACQUIRED}), results);
+
+    // Queued behind the running request until it is released
+    scheduler.Enqueue(Priority::HIGH,
+                      "second",
+                      "model",
+                      Scheduler::Clock::time_point::max(),
+                      nullptr,
+                      done);
+    scheduler.Enqueue(Priority::HIGH,
+                      "third",
+                      "model",
+                      Scheduler::Clock::time_point::max(),
+                      nullptr,
+                      done);
+    EXPECT_EQ(2, results.size());
+    EXPECT_EQ(Scheduler::Result::REJECTED, results.back());
+    scheduler.Release("model", 0, milliseconds(1));
+    EXPECT_EQ(3, results.size());
+    EXPECT_EQ(Scheduler::Result::ACQUIRED, results.back());
+    scheduler.Release("model", 0, milliseconds(1));
+}
+
+TEST(SchedulerUnittest, CancelQueued) {
+    Scheduler scheduler{false, 0, {}};
+    const double dropped = Metrics::Get("scheduler.dropped.cancelled");
+    vector<Scheduler::Result> results;
+    auto done = [&results](const Scheduler::Result result, unsigned int) {
+        results.push_back(result);
+    };
+    scheduler.Acquire(Priority::HIGH, "blocker", "model");
+    const uint64_t ticket = scheduler.Enqueue(
+        Priority::HIGH, "client", "model", Scheduler::Clock::time_point::max(), nullptr, done);
+    EXPECT_TRUE(results.empty());
+    scheduler.Cancel(ticket);
+    EXPECT_EQ((vector<Scheduler::Result>{Scheduler::Result::DROPPED}), results);
+    EXPECT_EQ(dropped + 1, Metrics::Get("scheduler.dropped.cancelled"));
+
+    // Cancelling a request that is no longer queued does nothing
+    scheduler.Cancel(ticket);
+    scheduler.Release("model", 0, milliseconds(1));
+    EXPECT_EQ(1, results.size());
+}
+}  // namespace scheduler_unittest
+}  // namespace acap_runtime
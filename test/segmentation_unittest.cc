@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "segmentation.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace std;
+
+namespace acap_runtime {
+namespace segmentation_unittest {
+
+const size_t numPixels = 513 * 513;
+const size_t numClasses = 21;
+
+// Scores where the expected class of pixel p is p % numClasses
+template <typename T>
+vector<T> MakeScores(T low, T high) {
+    vector<T> scores(numPixels * numClasses, low);
+    for (size_t p = 0; p < numPixels; p++) {
+        scores[p * numClasses + p % numClasses] = high;
+    }
+    return scores;
+}
+
+template <typename T>
+void VerifyArgmax(const vector<T>& scores) {
+    vector<uint8_t> classMap(numPixels);
+    ArgmaxChannels(scores.data(), numPixels, numClasses, classMap.data());
+    for (size_t p = 0; p < numPixels; p++) {
+        ASSERT_EQ(p % numClasses, classMap[p]) << "pixel " << p;
+    }
+}
+
+TEST(SegmentationUnittest, ArgmaxUint8) {
+    VerifyArgmax(MakeScores<uint8_t>(3, 200));
+}
+
+TEST(SegmentationUnittest, ArgmaxInt8) {
+    VerifyArgmax(MakeScores<int8_t>(-100, -5));
+}
+
+TEST(SegmentationUnittest, ArgmaxFloat) {
+    VerifyArgmax(MakeScores<float>(-1.5f, 0.25f));
+}
+
+TEST(SegmentationUnittest, ArgmaxTieResolvesToLowestIndex) {
+    const uint8_t scores[] = {1, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 2};
+    uint8_t classMap = 0xff;
+    ArgmaxChannels(scores, 1, sizeof(scores), &classMap);
+    EXPECT_EQ(1, classMap);
+}
+
+TEST(SegmentationUnittest, RunLengthEncode) {
+    const uint8_t classMap[] = {0, 0, 0, 5, 5, 1, 0, 0};
+    vector<int32_t> runs;
+    EXPECT_EQ(4, RunLengthEncode(classMap, sizeof(classMap), runs));
+    const vector<int32_t> expected = {0, 3, 5, 2, 1, 1, 0, 2};
+    EXPECT_EQ(expected, runs);
+}
+
+TEST(SegmentationUnittest, RunLengthEncodeEmpty) {
+    vector<int32_t> runs;
+    EXPECT_EQ(0, RunLengthEncode(nullptr, 0, runs));
+    EXPECT_TRUE(runs.empty());
+}
+}  // namespace segmentation_unittest
+}  // namespace acap_runtime
@@ -0,0 +1,275 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensor_conversion.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace std;
+using namespace tensorflow;
+
+namespace acap_runtime {
+namespace tensor_conversion_unittest {
+
+// Odd count, so that the scalar tail is used after the vectorized part
+const size_t count = 1000 + 13;
+
+template <typename T>
+void VerifyNarrow() {
+    vector<int32_t> values(count);
+    for (size_t i = 0; i < count; i++) {
+        values[i] = static_cast<int32_t>(i * 2654435761u);
+    }
+    vector<T> out(count);
+    NarrowInt32(values.data(), count, out.data());
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(static_cast<T>(values[i]), out[i]) << "value " << i;
+    }
+}
+
+TEST(TensorConversionUnittest, NarrowUint8) {
+    VerifyNarrow<uint8_t>();
+}
+
+TEST(TensorConversionUnittest, NarrowInt8) {
+    VerifyNarrow<int8_t>();
+}
+
+TEST(TensorConversionUnittest, NarrowUint16) {
+    VerifyNarrow<uint16_t>();
+}
+
+TEST(TensorConversionUnittest, NarrowInt16) {
+    VerifyNarrow<int16_t>();
+}
+
+TEST(TensorConversionUnittest, HalfRoundTrip) {
+    // Every half precision value converts to float and back unchanged
+    vector<uint16_t> halves(65536);
+    for (size_t i = 0; i < halves.size(); i++) {
+        halves[i] = static_cast<uint16_t>(i);
+    }
+    vector<float> floats(halves.size());
+    vector<uint16_t> out(halves.size());
+    HalfToFloat(halves.data(), halves.size(), floats.data());
+    FloatToHalf(floats.data(), floats.size(), out.data());
+    for (size_t i = 0; i < halves.size(); i++) {
+        const bool isNan = 0x7c00 == (halves[i] & 0x7c00) && 0 != (halves[i] & 0x3ff);
+        if (isNan) {
+            ASSERT_TRUE(std::isnan(floats[i])) << "value " << i;
+        } else {
+            ASSERT_EQ(halves[i], out[i]) << "value " << i;
+        }
+    }
+    EXPECT_EQ(1.0f, floats[0x3c00]);
+    EXPECT_EQ(-2.0f, floats[0xc000]);
+    EXPECT_EQ(65504.0f, floats[0x7bff]);
+    EXPECT_EQ(ldexp(1.0f, -24), floats[0x0001]);
+}
+
+TEST(TensorConversionUnittest, FloatToHalfRounding) {
+    // Repeated, so that both the vectorized part and the scalar tail are used
+    const vector<pair<float, uint16_t>> cases = {
+        {0.0f, 0x0000},
+        {-0.0f, 0x8000},
+        {1.0f + ldexp(1.0f, -11), 0x3c00},      // Tie rounds to even
+        {1.0f + 3 * ldexp(1.0f, -11), 0x3c02},  // Tie rounds to even
+        {1.0f + ldexp(1.0f, -11) + ldexp(1.0f, -20), 0x3c01},
+        {65504.0f, 0x7bff},
+        {65519.0f, 0x7bff},
+        {65520.0f, 0x7c00},  // Overflow
+        {-1e10f, 0xfc00},
+        {ldexp(1.0f, -24), 0x0001},  // Smallest subnormal
+        {ldexp(1.0f, -25), 0x0000},  // Tie rounds to even
+        {ldexp(3.0f, -26), 0x0001},
+        {ldexp(1.0f, -14) - ldexp(1.0f, -25), 0x0400},  // Rounds up to normal
+        {INFINITY, 0x7c00},
+        {-INFINITY, 0xfc00}};
+    vector<float> floats;
+    vector<uint16_t> expected;
+    for (int i = 0; i < 3; i++) {
+        for (auto& [value, half] : cases) {
+            floats.push_back(value);
+            expected.push_back(half);
+        }
+    }
+    vector<uint16_t> out(floats.size());
+    FloatToHalf(floats.data(), floats.size(), out.data());
+    for (size_t i = 0; i < floats.size(); i++) {
+        EXPECT_EQ(expected[i], out[i]) << "value " << floats[i];
+    }
+
+    float nan = NAN;
+    uint16_t half;
+    FloatToHalf(&nan, 1, &half);
+    EXPECT_EQ(0x7c00, half & 0x7c00);
+    EXPECT_NE(0, half & 0x3ff);
+}
+
+TEST(TensorConversionUnittest, PackFloat) {
+    TensorProto tensor;
+    tensor.set_dtype(DataType::DT_FLOAT);
+    tensor.add_float_val(0.5);
+    tensor.add_float_val(-2);
+    string buffer;
+    ASSERT_TRUE(PackTensorValues(tensor, 2, buffer));
+    ASSERT_EQ(2 * sizeof(float), buffer.size());
+    const float* values = reinterpret_cast<const float*>(buffer.data());
+    EXPECT_EQ(0.5, values[0]);
+    EXPECT_EQ(-2, values[1]);
+}
+
+TEST(TensorConversionUnittest, PackUint8) {
+    TensorProto tensor;
+    tensor.set_dtype(DataType::DT_UINT8);
+    for (int i = 0; i < 300; i++) {
+        tensor.add_int_val(i % 256);
+    }
+    string buffer;
+    ASSERT_TRUE(PackTensorValues(tensor, 300, buffer));
+    ASSERT_EQ(300u, buffer.size());
+    for (int i = 0; i < 300; i++) {
+        ASSERT_EQ(i % 256, static_cast<uint8_t>(buffer[i])) << "value " << i;
+    }
+}
+
+TEST(TensorConversionUnittest, PackHalf) {
+    TensorProto tensor;
+    tensor.set_dtype(DataType::DT_HALF);
+    tensor.add_half_val(0x3c00);
+    string buffer;
+    ASSERT_TRUE(PackTensorValues(tensor, 1, buffer));
+    ASSERT_EQ(sizeof(uint16_t), buffer.size());
+    EXPECT_EQ(0x3c00, *reinterpret_cast<const uint16_t*>(buffer.data()));
+}
+
+TEST(TensorConversionUnittest, Broadcast) {
+    TensorProto tensor;
+    tensor.set_dtype(DataType::DT_INT32);
+    tensor.add_int_val(7);
+    string buffer;
+    ASSERT_TRUE(PackTensorValues(tensor, 100, buffer));
+    ASSERT_EQ(100 * sizeof(int32_t), buffer.size());
+    const int32_t* values = reinterpret_cast<const int32_t*>(buffer.data());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(7, values[i]);
+    }
+
+    // The last value is repeated and no values give zeros
+    tensor.add_int_val(9);
+    ASSERT_TRUE(PackTensorValues(tensor, 4, buffer));
+    values = reinterpret_cast<const int32_t*>(buffer.data());
+    EXPECT_EQ(vector<int32_t>({7, 9, 9, 9}), vector<int32_t>(values, values + 4));
+    tensor.clear_int_val();
+    ASSERT_TRUE(PackTensorValues(tensor, 4, buffer));
+    values = reinterpret_cast<const int32_t*>(buffer.data());
+    EXPECT_EQ(vector<int32_t>({0, 0, 0, 0}), vector<int32_t>(values, values + 4));
+}
+
+TEST(TensorConversionUnittest, Normalize) {
+    vector<float> values(19);
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = i * 15;
+    }
+    InputTransform transform;
+    transform.mean = 127.5;
+    transform.std = 127.5;
+    vector<float> out(values.size());
+    NormalizeFloat(values.data(), values.size(), transform, out.data());
+    for (size_t i = 0; i < values.size(); i++) {
+        EXPECT_NEAR((values[i] - 127.5f) / 127.5f, out[i], 1e-6) << "Value " << i;
+    }
+}
+
+TEST(TensorConversionUnittest, Quantize) {
+    // Enough values for both the vectorized and the scalar part
+    const vector<float> values = {-1,    -0.5,  0,     0.5,   1,   0.25, -0.25, 0.75,
+                                  -0.75, 2,     -2,    0.125, 0.1, -0.1, 0.3,   -0.3,
+                                  0.99,  -0.99, 0.004, -0.004};
+    InputTransform transform;
+    transform.scale = 1.0f / 128;
+    transform.zeroPoint = 128;
+    vector<uint8_t> unsignedOut(values.size());
+    QuantizeFloat(values.data(), values.size(), transform, unsignedOut.data());
+    transform.zeroPoint = 0;
+    vector<int8_t> signedOut(values.size());
+    QuantizeFloat(values.data(), values.size(), transform, signedOut.data());
+    for (size_t i = 0; i < values.size(); i++) {
+        const float q = round(values[i] * 128);
+        EXPECT_EQ(min(max(q + 128, 0.0f), 255.0f), unsignedOut[i]) << "Value " << i;
+        EXPECT_EQ(min(max(q, -128.0f), 127.0f), signedOut[i]) << "Value " << i;
+    }
+
+    // Normalization is applied before quantization, and ties round away from
+    // zero before the zero point is added
+    transform.mean = 0.5;
+    transform.std = 2;
+    transform.scale = 0.5;
+    transform.zeroPoint = 3;
+    const float ties[] = {1.5, -0.5, 1, 0, 1000, -1000};
+    int8_t tiesOut[6];
+    QuantizeFloat(ties, 6, transform, tiesOut);
+    EXPECT_EQ(vector<int8_t>({4, 2, 4, 2, 127, -128}), vector<int8_t>(tiesOut, tiesOut + 6));
+}
+
+TEST(TensorConversionUnittest, Transpose) {
+    // RGB and other channel counts, with images larger than a cache block
+    for (size_t channels : {1, 3, 4, 80}) {
+        const size_t pixels = 67 * 69;
+        vector<uint8_t> interleaved(pixels * channels);
+        for (size_t i = 0; i < interleaved.size(); i++) {
+            interleaved[i] = i * 13;
+        }
+        vector<uint8_t> planar(interleaved.size());
+        ASSERT_TRUE(InterleavedToPlanar(interleaved.data(), pixels, channels, 1, planar.data()));
+        for (size_t c = 0; c < channels; c++) {
+            for (size_t p = 0; p < pixels; p++) {
+                ASSERT_EQ(interleaved[p * channels + c], planar[c * pixels + p])
+                    << "Channel " << c << " pixel " << p;
+            }
+        }
+        vector<uint8_t> roundTrip(interleaved.size());
+        ASSERT_TRUE(PlanarToInterleaved(planar.data(), pixels, channels, 1, roundTrip.data()));
+        EXPECT_EQ(interleaved, roundTrip) << channels << " channels";
+    }
+
+    const float rgb[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    float planes[15];
+    ASSERT_TRUE(InterleavedToPlanar(rgb, 5, 3, sizeof(float), planes));
+    EXPECT_EQ(vector<float>({1, 4, 7, 10, 13, 2, 5, 8, 11, 14, 3, 6, 9, 12, 15}),
+              vector<float>(planes, planes + 15));
+    const uint16_t halves[] = {1, 2, 3, 4};
+    uint16_t halfPlanes[4];
+    ASSERT_TRUE(InterleavedToPlanar(halves, 2, 2, sizeof(uint16_t), halfPlanes));
+    EXPECT_EQ(vector<uint16_t>({1, 3, 2, 4}), vector<uint16_t>(halfPlanes, halfPlanes + 4));
+    EXPECT_FALSE(InterleavedToPlanar(halves, 1, 1, 8, halfPlanes));
+}
+
+TEST(TensorConversionUnittest, Invalid) {
+    TensorProto tensor;
+    tensor.set_dtype(DataType::DT_FLOAT);
+    tensor.add_float_val(1);
+    tensor.add_float_val(2);
+    string buffer;
+    EXPECT_FALSE(PackTensorValues(tensor, 1, buffer));
+
+    tensor.set_dtype(DataType::DT_STRING);
+    tensor.add_string_val("/test.bmp");
+    EXPECT_FALSE(PackTensorValues(tensor, 1, buffer));
+}
+}  // namespace tensor_conversion_unittest
+}  // namespace acap_runtime
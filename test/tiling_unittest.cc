@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tiling.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace std;
+
+namespace acap_runtime {
+namespace tiling_unittest {
+
+TEST(TilingUnittest, TilesCoverImage) {
+    const int width = 1920;
+    const int height = 1080;
+    const int overlap = 32;
+    vector<Tile> tiles = ComputeTiles(width, height, 300, 300, overlap);
+
+    // 8 columns and 4 rows are needed for a 300 pixel tile with overlap
+    ASSERT_EQ(8 * 4, tiles.size());
+    EXPECT_EQ(0, tiles.front().x);
+    EXPECT_EQ(0, tiles.front().y);
+    EXPECT_EQ(width, tiles.back().x + tiles.back().width);
+    EXPECT_EQ(height, tiles.back().y + tiles.back().height);
+    for (size_t i = 1; i < 8; i++) {
+        EXPECT_GE(tiles[i - 1].x + tiles[i - 1].width - tiles[i].x, overlap);
+        EXPECT_EQ(0, tiles[i].x % 2);
+    }
+}
+
+TEST(TilingUnittest, SmallImageGivesSingleTile) {
+    vector<Tile> tiles = ComputeTiles(200, 150, 300, 300, 16);
+    ASSERT_EQ(1, tiles.size());
+    EXPECT_EQ(200, tiles[0].width);
+    EXPECT_EQ(150, tiles[0].height);
+}
+
+TEST(TilingUnittest, TileToImage) {
+    const Tile tile{500, 200, 300, 300};
+    Detection detection = TileToImage({0, 0, 1, 0.5}, tile, 1000, 1000);
+    EXPECT_FLOAT_EQ(0.2, detection.ymin);
+    EXPECT_FLOAT_EQ(0.5, detection.xmin);
+    EXPECT_FLOAT_EQ(0.5, detection.ymax);
+    EXPECT_FLOAT_EQ(0.65, detection.xmax);
+}
+
+TEST(TilingUnittest, MergeSplitObject) {
+    // An object split on a tile border, a duplicate and an unrelated object
+    vector<Detection> detections = {{0.1, 0.1, 0.3, 0.52, 1, 0.6},
+                                    {0.1, 0.48, 0.3, 0.7, 1, 0.8},
+                                    {0.1, 0.5, 0.3, 0.7, 1, 0.7},
+                                    {0.1, 0.45, 0.3, 0.55, 2, 0.9},
+                                    {0.6, 0.6, 0.8, 0.8, 1, 0.5}};
+    vector<Detection> merged = MergeDetections(detections, 0.05);
+    ASSERT_EQ(3, merged.size());
+    EXPECT_FLOAT_EQ(2, merged[0].classId);
+    EXPECT_FLOAT_EQ(0.8, merged[1].score);
+    EXPECT_FLOAT_EQ(0.1, merged[1].xmin);
+    EXPECT_FLOAT_EQ(0.7, merged[1].xmax);
+    EXPECT_FLOAT_EQ(0.6, merged[2].ymin);
+}
+}  // namespace tiling_unittest
+}  // namespace acap_runtime
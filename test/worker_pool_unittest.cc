@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2026 Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace std;
+
+namespace acap_runtime {
+namespace worker_pool_unittest {
+
+TEST(WorkerPoolUnittest, RunAll) {
+    atomic<int> done{0};
+    {
+        WorkerPool workers{3};
+        EXPECT_EQ(3, Metrics::Get("workers.threads"));
+        for (int i = 0; i < 100; i++) {
+            workers.Run([&done] { done++; });
+        }
+    }
+    // Queued work is done before the pool is destroyed
+    EXPECT_EQ(100, done);
+    EXPECT_EQ(0, Metrics::Get("workers.busy"));
+}
+
+TEST(WorkerPoolUnittest, Concurrent) {
+    // Blocking work on one thread does not hold up the others
+    WorkerPool workers{2};
+    mutex m;
+    condition_variable cv;
+    bool released = false;
+    atomic<bool> ran{false};
+    workers.Run([&] {
+        unique_lock lock(m);
+        cv.wait(lock, [&] { return released; });
+    });
+    workers.Run([&] {
+        ran = true;
+        scoped_lock lock(m);
+        released = true;
+        cv.notify_all();
+    });
+    unique_lock lock(m);
+    EXPECT_TRUE(cv.wait_for(lock, chrono::seconds(5), [&] { return released; }));
+    EXPECT_TRUE(ran);
+}
+
+TEST(WorkerPoolUnittest, RunFirst) {
+    // Work queued first runs ahead of the work queued before it
+    WorkerPool workers{1};
+    mutex m;
+    condition_variable cv;
+    bool released = false;
+    vector<int> order;
+    workers.Run([&] {
+        unique_lock lock(m);
+        cv.wait(lock, [&] { return released; });
+    });
+    auto append = [&](const int value) {
+        scoped_lock lock(m);
+        order.push_back(value);
+        cv.notify_all();
+    };
+    workers.Run([&] { append(1); });
+    workers.Run([&] { append(2); }, true);
+    unique_lock lock(m);
+    released = true;
+    cv.notify_all();
+    EXPECT_TRUE(cv.wait_for(lock, chrono::seconds(5), [&] { return 2 == order.size(); }));
+    EXPECT_EQ((vector<int>{2, 1}), order);
+}
+}  // namespace worker_pool_unittest
+}  // namespace acap_runtime